@@ -0,0 +1,135 @@
+// Times the bytecode interpreter against the tree-walking evaluator on the
+// instruction mix of generated processes. Built with
+// -DOSEMU_BUILD_BENCHMARKS=ON; takes an optional instruction count.
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "instruction_generator.hpp"
+#include "lockstep.hpp"
+#include "program_image.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kRounds = 5;
+constexpr size_t kLogLines = 1024;
+
+struct Timing {
+  double best_ns{std::numeric_limits<double>::max()};
+  uint16_t x{0};
+};
+
+// Best time per instruction per copy of running `copies` copies of the
+// program with `run`, which gets every copy's evaluator.
+template <typename Run>
+Timing measure(const osemu::ProgramImage& image, size_t copies, Run run) {
+  Timing timing;
+  for (int round = 0; round < kRounds; ++round) {
+    std::vector<osemu::InstructionEvaluator> evaluators(copies);
+    for (auto& evaluator : evaluators) {
+      evaluator.bind_symbols(image.names());
+      evaluator.configure_output_log(kLogLines, nullptr, 0);
+    }
+
+    auto start = Clock::now();
+    run(evaluators);
+    std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+
+    timing.best_ns = std::min(timing.best_ns, elapsed.count() / (image.size() * copies));
+    for (const auto& evaluator : evaluators) {
+      if (evaluator.load_variable("x") != evaluators.front().load_variable("x")) {
+        timing.x = 0;
+        break;
+      }
+      timing.x = evaluator.load_variable("x");
+    }
+  }
+  return timing;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  size_t count = argc > 1 ? std::stoul(argv[1]) : 1000000;
+  constexpr size_t kUnbounded = std::numeric_limits<size_t>::max();
+
+  osemu::InstructionGenerator generator;
+  // The image keeps only bytecode; the tree walker runs the parsed program.
+  const std::vector<osemu::Expr> program = generator.generateInstructions(count);
+  osemu::ProgramImage image(program);
+
+  Timing tree = measure(image, 1, [&](std::vector<osemu::InstructionEvaluator>& evaluators) {
+    evaluators[0].evaluate_program(program);
+  });
+  Timing bytecode = measure(image, 1, [&](std::vector<osemu::InstructionEvaluator>& evaluators) {
+    osemu::ExecutionContext context;
+    while (context.pc < image.segment_count()) {
+      osemu::run_program(image, context, evaluators[0], kUnbounded);
+    }
+  });
+
+  // A full group of copies, one after another and then in lockstep, on the
+  // generated mix and on its ADD lines alone, where no PRINT hides the
+  // arithmetic.
+  constexpr size_t kCopies = osemu::kLockstepLanes;
+  auto separate_run = [&](const osemu::ProgramImage& program) {
+    return [&](std::vector<osemu::InstructionEvaluator>& evaluators) {
+      for (auto& evaluator : evaluators) {
+        osemu::ExecutionContext context;
+        while (context.pc < program.segment_count()) {
+          osemu::run_program(program, context, evaluator, kUnbounded);
+        }
+      }
+    };
+  };
+  auto lockstep_run = [&](const osemu::ProgramImage& program) {
+    return [&](std::vector<osemu::InstructionEvaluator>& evaluators) {
+      std::vector<osemu::LockstepLane> lanes;
+      for (auto& evaluator : evaluators) {
+        lanes.push_back({&evaluator});
+      }
+      osemu::ExecutionContext context;
+      while (context.pc < program.segment_count()) {
+        osemu::run_lockstep(program, context, lanes, kUnbounded);
+      }
+    };
+  };
+
+  std::vector<osemu::Expr> adds;
+  for (const auto& instruction : program) {
+    if (instruction.type == osemu::Expr::ADD) {
+      adds.push_back(instruction);
+    }
+  }
+  osemu::ProgramImage arithmetic(adds);
+
+  Timing separate = measure(image, kCopies, separate_run(image));
+  Timing lockstep = measure(image, kCopies, lockstep_run(image));
+  Timing separate_adds = measure(arithmetic, kCopies, separate_run(arithmetic));
+  Timing lockstep_adds = measure(arithmetic, kCopies, lockstep_run(arithmetic));
+
+  std::cout << count << " instructions, best of " << kRounds << " rounds, ns/instruction\n"
+            << "  tree walk:                 " << tree.best_ns << "\n"
+            << "  bytecode:                  " << bytecode.best_ns << "\n"
+            << "  " << kCopies << " copies, separate:       " << separate.best_ns << "\n"
+            << "  " << kCopies << " copies, lockstep:       " << lockstep.best_ns << "\n"
+            << "  " << kCopies << " copies, ADDs, separate: " << separate_adds.best_ns << "\n"
+            << "  " << kCopies << " copies, ADDs, lockstep: " << lockstep_adds.best_ns << "\n";
+  if (separate_adds.x != lockstep_adds.x) {
+    std::cerr << "Results differ: x = " << separate_adds.x << " vs " << lockstep_adds.x << std::endl;
+    return 1;
+  }
+  for (const Timing* timing : {&bytecode, &separate, &lockstep}) {
+    if (timing->x != tree.x) {
+      std::cerr << "Results differ: x = " << tree.x << " vs " << timing->x << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
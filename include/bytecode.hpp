@@ -0,0 +1,148 @@
+#ifndef OSEMU_BYTECODE_H_
+#define OSEMU_BYTECODE_H_
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "instruction_parser.hpp"
+
+namespace osemu {
+
+enum class OpCode : uint8_t {
+  kNop,
+  kDeclare,    // dest = b
+  kAdd,        // dest = a + b, saturating
+  kSub,        // dest = a - b, clamped at 0
+  kPrint,      // prefix, then a (as text) and b if present, then suffix
+  kSleep,      // sleep for b ticks
+  kLoopBegin,  // run the body b times; jump is the matching kLoopEnd
+  kLoopEnd,    // jump is the first body instruction
+  kFault,      // a source instruction that could not be compiled; dest is its Fault
+
+  // Superinstructions: the first of a pair, followed by the second in its
+  // usual form. They run both halves when the run's budget allows.
+  kPrintAdd,
+  kAddPrint,   // only when the PRINT shows the variable the ADD wrote
+  kDeclareAdd,
+};
+
+// The instruction a superinstruction starts with; other opcodes unchanged.
+inline OpCode first_half(OpCode op) {
+  switch (op) {
+    case OpCode::kPrintAdd:
+      return OpCode::kPrint;
+    case OpCode::kAddPrint:
+      return OpCode::kAdd;
+    case OpCode::kDeclareAdd:
+      return OpCode::kDeclare;
+    default:
+      return op;
+  }
+}
+
+struct Operand {
+  enum Kind : uint8_t { kNone, kConstant, kVariable };
+
+  Kind kind{kNone};
+  // The constant itself, or the variable's slot: its index in
+  // Bytecode::names.
+  uint16_t value{0};
+
+  static Operand constant(uint16_t v) { return {kConstant, v}; }
+  static Operand variable(uint16_t index) { return {kVariable, index}; }
+};
+
+struct Instruction {
+  static constexpr uint8_t kGreeting = 1;    // kPrint: print the process greeting.
+  static constexpr uint8_t kClosedForm = 2;  // kLoopBegin: see closed_form() in bytecode.cpp.
+
+  OpCode op{OpCode::kNop};
+  uint8_t flags{0};
+  uint16_t dest{0};
+  Operand a;
+  Operand b;
+  uint32_t prefix{0};  // Message ids, see MessageTable.
+  uint32_t suffix{0};
+  uint32_t jump{0};    // Index of the target in the program's code.
+  // kLoopBegin: leaf instructions in one pass of the body.
+  uint32_t body_cost{0};
+};
+
+// Flat encoding of a program. Each source instruction becomes a short run
+// of Instructions, with FOR lowered to a counted loop, and variables are
+// referred to by slot, their index in `names`. A source instruction that
+// does nothing still compiles to one kNop so that it takes its tick, and one
+// that is malformed compiles to one kFault, which verify() rejects.
+// Adjacent pairs that occur often are then fused into superinstructions.
+class Bytecode {
+ public:
+  // FOR nests at most three deep; deeper loops compile to a kFault.
+  static constexpr size_t kMaxLoopDepth = 3;
+
+  static Bytecode compile(const std::vector<Expr>& program);
+
+  // Leaf instructions a run executes, each FOR body counted once per
+  // iteration. A loop whose count is a variable is counted as one iteration
+  // here and corrected when it starts; see StepResult::leaf_delta.
+  size_t flat_size() const { return flat_size_; }
+  // The first source instruction that compiled to a kFault, counted from 1,
+  // and why; 0 and Fault::kNone when every one compiled.
+  size_t fault_instruction() const { return fault_instruction_; }
+  Fault fault() const { return fault_; }
+  std::span<const Instruction> code() const { return code_; }
+  const std::vector<std::string>& names() const { return names_; }
+  size_t memory_bytes() const;
+
+ private:
+  class Compiler;
+
+  std::vector<Instruction> code_;
+  std::vector<std::string> names_;
+  size_t flat_size_{0};
+  size_t fault_instruction_{0};
+  Fault fault_{Fault::kNone};
+};
+
+// Where a process is in its program, kept between ticks: the segment of
+// code (see ProgramImage::segment), the position in it and the iterations
+// left in each enclosing loop.
+struct ExecutionContext {
+  size_t pc{0};
+  uint32_t ip{0};
+  uint8_t depth{0};
+  std::array<uint16_t, Bytecode::kMaxLoopDepth> remaining{};
+  // Ticks still to be charged for a loop whose result was computed at once.
+  uint64_t pending{0};
+
+  bool operator==(const ExecutionContext&) const = default;
+};
+
+// Checks once, when a program is loaded, everything run_bytecode takes on
+// trust: known opcodes and flags and no kFault, operands present where
+// required, variable slots below `name_count`, loops nested at most
+// kMaxLoopDepth deep with each kLoopBegin and kLoopEnd jumping to the other,
+// closed-form loops that qualify, and superinstructions followed by their
+// second half.
+bool verify(std::span<const Instruction> code, size_t name_count);
+
+struct StepResult {
+  size_t leaves{0};       // Leaf instructions that ran.
+  uint16_t sleep{0};      // Ticks a SLEEP asked for.
+  int64_t leaf_delta{0};  // Correction to flat_size() from variable loop counts.
+  Fault fault{Fault::kNone};  // Set when the program could not be run.
+};
+
+// Resumes `code`, segment context.pc of a program, and runs up to `budget`
+// leaf instructions. Stops early after a SLEEP, or at the end of the code
+// with context.ip at code.size(). Nothing is checked as it runs:
+// `code` must have passed verify(). PRINT("") records a greeting, which
+// the log renders as "Hello world from <process name>!".
+StepResult run_bytecode(std::span<const Instruction> code, ExecutionContext& context,
+                        InstructionEvaluator& evaluator, size_t budget = 1);
+
+}
+
+#endif
@@ -12,6 +12,7 @@ enum class Commands {
   SchedulerStart,
   SchedulerStop,
   ReportUtil,
+  Renice,
   Clear,
   Exit
 };
@@ -3,10 +3,12 @@
 
 #include <cstdint>
 #include <filesystem>
+#include <string>
 
 namespace osemu {
 
 enum class SchedulingAlgorithm { FCFS, RoundRobin };
+enum class AdmissionPolicy { Defer, Reject };
 
 struct Config {
   uint32_t cpuCount{4};
@@ -16,6 +18,24 @@ struct Config {
   uint32_t minInstructions{1000};
   uint32_t maxInstructions{2000};
   uint32_t delayCyclesPerInstruction{0};
+  // Instructions a core runs on each tick it executes a process.
+  uint32_t instructionsPerTick{1};
+
+  // Admission limits; 0 means unlimited.
+  uint32_t maxReadyQueue{0};
+  uint32_t maxLiveProcesses{0};
+  uint64_t maxResidentInstructions{0};
+  AdmissionPolicy admissionPolicy{AdmissionPolicy::Defer};
+
+  // Finished process records kept in memory (0 = all), and the file their
+  // logs are spilled to on completion (empty = logs are dropped).
+  uint32_t maxFinishedRecords{0};
+  std::string archiveLogFile;
+
+  // Log lines each process keeps in memory (0 = all), and the file older
+  // lines overflow to (empty = they are dropped).
+  uint32_t logBufferLines{1024};
+  std::string logSpillFile;
 
   explicit Config(uint32_t cpu = 4,
                   SchedulingAlgorithm sched = SchedulingAlgorithm::RoundRobin,
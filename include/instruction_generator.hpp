@@ -4,6 +4,7 @@
 #include <vector>
 #include <random>
 #include "instruction_parser.hpp"
+#include "program_image.hpp"
 
 namespace osemu {
 
@@ -28,8 +29,10 @@ private:
 public:
     InstructionGenerator();
     
-    std::vector<Expr> generateInstructions(size_t count, const std::string& process_name);
-    std::vector<Expr> generateRandomProgram(size_t min_instructions, size_t max_instructions, const std::string& process_name);
+    std::vector<Expr> generateInstructions(size_t count);
+    std::vector<Expr> generateRandomProgram(size_t min_instructions, size_t max_instructions);
+    // Same program shape as generateRandomProgram, produced on demand from a seed.
+    ProgramImagePtr generateLazyProgram(size_t min_instructions, size_t max_instructions);
 };
 
 }  
@@ -1,162 +1,118 @@
 #ifndef OSEMU_INSTRUCTION_PARSER_H_
 #define OSEMU_INSTRUCTION_PARSER_H_
 
+#include <atomic>
 #include <string>
 #include <vector>
 #include <memory>
+#include <string_view>
 #include <variant>
 #include <iostream>
 #include <unordered_map>
 
+#include "log_record.hpp"
+#include "process_log.hpp"
+
 namespace osemu {
 
+// Operand of an instruction, held inline: a number, or the id of an
+// interned string or variable name (see MessageTable).
 struct Atom {
-    enum Type { STRING, NAME, NUMBER };
-    Type type;
-    std::string string_value;
-    uint16_t number_value;
-    
-    Atom(std::string s, Type t) : type(t), string_value(std::move(s)), number_value(0) {}
+    enum Type : uint8_t { NONE, STRING, NAME, NUMBER };
+    Type type{NONE};
+    uint16_t number_value{0};
+    uint32_t string_id{0};
+    
+    Atom() = default;
+    Atom(std::string_view s, Type t)
+        : type(t), string_id(MessageTable::instance().intern(s)) {}
     Atom(uint16_t n) : type(NUMBER), number_value(n) {}
     
+    explicit operator bool() const { return type != NONE; }
+    const std::string& text() const { return MessageTable::instance().text(string_id); }
+    
     std::string to_string() const {
         switch (type) {
             case STRING:
             case NAME:
-                return string_value;
+                return text();
             case NUMBER:
                 return std::to_string(number_value);
+            case NONE:
+                break;
         }
         return "";
     }
 };
 
+// One instruction. Operands are inline and names are interned, so only a
+// FOR body allocates.
+//
+//   DECLARE  name = lhs
+//   CALL     name(lhs), or name(lhs + rhs)
+//   ADD/SUB  name = lhs +/- rhs
+//   FOR      body, lhs times
 struct Expr {
-    enum Type { DECLARE, CALL, CONSTANT, VOID_EXPR, ADD, SUB, FOR };
+    enum Type : uint8_t { DECLARE, CALL, CONSTANT, VOID_EXPR, ADD, SUB, FOR };
     Type type;
     
-    std::string var_name;
-    std::unique_ptr<Atom> atom_value;
-    std::unique_ptr<Atom> lhs;
-    std::unique_ptr<Atom> rhs;
-    std::unique_ptr<Atom> n;
+    uint32_t name{0};
+    Atom lhs;
+    Atom rhs;
     std::vector<Expr> body;
     
     Expr(Type t) : type(t) {}
     
-    Expr(const Expr& other)
-        : type(other.type), var_name(other.var_name) {
-        if (other.atom_value) {
-            atom_value = std::make_unique<Atom>(*other.atom_value);
-        }
-        if (other.lhs) {
-            lhs = std::make_unique<Atom>(*other.lhs);
-        }
-        if (other.rhs) {
-            rhs = std::make_unique<Atom>(*other.rhs);
-        }
-        if (other.n) {
-            n = std::make_unique<Atom>(*other.n);
-        }
-        body = other.body;
-    }
-    
-    Expr& operator=(const Expr& other) {
-        if (this != &other) {
-            type = other.type;
-            var_name = other.var_name;
-            atom_value.reset();
-            if (other.atom_value) {
-                atom_value = std::make_unique<Atom>(*other.atom_value);
-            }
-            
-            lhs.reset();
-            if (other.lhs) {
-                lhs = std::make_unique<Atom>(*other.lhs);
-            }
-            
-            rhs.reset();
-            if (other.rhs) {
-                rhs = std::make_unique<Atom>(*other.rhs);
-            }
-            
-            n.reset();
-            if (other.n) {
-                n = std::make_unique<Atom>(*other.n);
-            }
-            
-            body = other.body;
-        }
-        return *this;
-    }
-    
-    Expr(Expr&& other) noexcept
-        : type(other.type), var_name(std::move(other.var_name)),
-          atom_value(std::move(other.atom_value)),
-          lhs(std::move(other.lhs)), rhs(std::move(other.rhs)),
-          n(std::move(other.n)), body(std::move(other.body)) {}
-    
-    Expr& operator=(Expr&& other) noexcept {
-        if (this != &other) {
-            type = other.type;
-            var_name = std::move(other.var_name);
-            atom_value = std::move(other.atom_value);
-            lhs = std::move(other.lhs);
-            rhs = std::move(other.rhs);
-            n = std::move(other.n);
-            body = std::move(other.body);
-        }
-        return *this;
-    }
+    const std::string& name_text() const { return MessageTable::instance().text(name); }
     
-    static Expr make_declare(std::string name, std::unique_ptr<Atom> value) {
+    static Expr make_declare(uint32_t name, Atom value) {
         Expr e(DECLARE);
-        e.var_name = std::move(name);
-        e.atom_value = std::move(value);
+        e.name = name;
+        e.lhs = value;
         return e;
     }
     
-    static Expr make_call(std::string name, std::unique_ptr<Atom> arg) {
+    static Expr make_call(uint32_t name, Atom arg) {
         Expr e(CALL);
-        e.var_name = std::move(name);
-        e.atom_value = std::move(arg);
+        e.name = name;
+        e.lhs = arg;
         return e;
     }
 
-    static Expr make_call_concat(std::string name, std::unique_ptr<Atom> lhs, std::unique_ptr<Atom> rhs) {
+    static Expr make_call_concat(uint32_t name, Atom lhs, Atom rhs) {
         Expr e(CALL);
-        e.var_name = std::move(name);
-        e.lhs = std::move(lhs);
-        e.rhs = std::move(rhs);
+        e.name = name;
+        e.lhs = lhs;
+        e.rhs = rhs;
         return e;
     }
     
-    static Expr make_add(std::string var, std::unique_ptr<Atom> lhs, std::unique_ptr<Atom> rhs) {
+    static Expr make_add(uint32_t var, Atom lhs, Atom rhs) {
         Expr e(ADD);
-        e.var_name = std::move(var);
-        e.lhs = std::move(lhs);
-        e.rhs = std::move(rhs);
+        e.name = var;
+        e.lhs = lhs;
+        e.rhs = rhs;
         return e;
     }
     
-    static Expr make_sub(std::string var, std::unique_ptr<Atom> lhs, std::unique_ptr<Atom> rhs) {
+    static Expr make_sub(uint32_t var, Atom lhs, Atom rhs) {
         Expr e(SUB);
-        e.var_name = std::move(var);
-        e.lhs = std::move(lhs);
-        e.rhs = std::move(rhs);
+        e.name = var;
+        e.lhs = lhs;
+        e.rhs = rhs;
         return e;
     }
     
-    static Expr make_for(std::vector<Expr> body, std::unique_ptr<Atom> n) {
+    static Expr make_for(std::vector<Expr> body, Atom n) {
         Expr e(FOR);
         e.body = std::move(body);
-        e.n = std::move(n);
+        e.lhs = n;
         return e;
     }
     
-    static Expr make_constant(std::unique_ptr<Atom> value) {
+    static Expr make_constant(Atom value) {
         Expr e(CONSTANT);
-        e.atom_value = std::move(value);
+        e.lhs = value;
         return e;
     }
 };
@@ -189,31 +145,91 @@ private:
     static bool consume_tag(const std::string& input, const std::string& tag, std::string& remaining);
 };
 
+// Why an instruction could not run. Malformed instructions are reported
+// with one of these rather than thrown, and do nothing.
+enum class Fault : uint8_t {
+    kNone,
+    kMissingOperand,
+    kNotNumeric,       // A string where a number or variable belongs.
+    kUnknownFunction,
+    kUnknownInstruction,
+    kLoopTooDeep,
+    kTooManyVariables,
+    kUnverifiedProgram,  // The image's code did not pass verify().
+};
+
+const char* to_string(Fault fault);
+
+// Variables live in slots: the program image numbers its variable names
+// once, and each process keeps one uint16_t per name, indexed directly.
 class InstructionEvaluator {
 private:
-    std::unordered_map<std::string, uint16_t> variables;
-    std::vector<std::string> output_log;
+    const std::vector<std::string>* symbols_{nullptr};
+    // Names the tree walker stored to that the bound table lacks; their
+    // slots follow the table's.
+    std::vector<std::string> extra_names_;
+    std::vector<uint16_t> slots_;
+    ProcessLog output_log;
+
+    // Heap bytes held by `slots_`, readable from other threads at any time.
+    std::atomic<size_t> variable_bytes_{0};
+
+    // Slot of `name` in the bound symbol table, or -1.
+    int slot_of(const std::string& name) const;
+    void update_variable_bytes();
+
+    // Stamped on every PRINT record: the tick and core it ran on.
+    uint64_t log_tick_{0};
+    int16_t log_core_{-1};
+
+    LogRecord new_log_record() const;
     
 public:
     InstructionEvaluator();
     
-    uint16_t resolve_atom_value(const Atom& atom);
+    Fault resolve_atom_value(const Atom& atom, uint16_t& value) const;
     std::string print_atom_to_string(const Atom& atom);
 
-    void evaluate(const Expr& expr);
-    void evaluate_program(const std::vector<Expr>& program);
-    
-    void handle_declare(const std::string& var_name, const Atom& value);
-    std::string handle_print(const Atom& arg, const std::string& process_name);
-    void handle_sleep(const Atom& duration);
-    void handle_add(const std::string& var, const Atom& lhs, const Atom& rhs);
-    void handle_sub(const std::string& var, const Atom& lhs, const Atom& rhs);
-    void handle_for(const std::vector<Expr>& body, const Atom& count);
+    Fault evaluate(const Expr& expr);
+    // Runs every instruction and returns the first fault.
+    Fault evaluate_program(const std::vector<Expr>& program);
+    
+    Fault handle_declare(const std::string& var_name, const Atom& value);
+    void set_log_context(uint64_t tick, int core) {
+        log_tick_ = tick;
+        log_core_ = static_cast<int16_t>(core);
+    }
+    Fault handle_print(const Atom& arg);
+    Fault handle_print_concat(const Atom& lhs, const Atom& rhs);
+    // Appends a PRINT record with the message fields of `record`, stamped
+    // with the current tick, time and core.
+    void print(const LogRecord& record);
+
+    // Gives every name in `symbols` a zeroed slot. `symbols` is the program
+    // image's name table and must outlive the evaluator.
+    void bind_symbols(const std::vector<std::string>& symbols);
+    uint16_t load_slot(uint16_t slot) const { return slots_[slot]; }
+    void store_slot(uint16_t slot, uint16_t value) { slots_[slot] = value; }
+
+    // By-name access for the tree walker. Names outside the bound table read
+    // as 0 until stored, which gives them a slot of their own.
+    uint16_t load_variable(const std::string& name) const;
+    Fault store_variable(const std::string& name, uint16_t value);
+    Fault handle_sleep(const Atom& duration);
+    Fault handle_add(const std::string& var, const Atom& lhs, const Atom& rhs);
+    Fault handle_sub(const std::string& var, const Atom& lhs, const Atom& rhs);
+    Fault handle_for(const std::vector<Expr>& body, const Atom& count);
     
     void clear_variables();
     void dump_variables() const;
-    const std::vector<std::string>& get_output_log() const { return output_log; }
-    void clear_output_log() { output_log.clear(); }
+    void configure_output_log(size_t capacity, LogSpillFile* spill, uint32_t pid) {
+        output_log.configure(capacity, spill, pid);
+    }
+    void discard_output_log() { output_log.discard(); }
+    const ProcessLog& get_output_log() const { return output_log; }
+
+    size_t variable_bytes() const { return variable_bytes_.load(std::memory_order_relaxed); }
+    size_t log_bytes() const { return output_log.memory_bytes(); }
 };
 
 }
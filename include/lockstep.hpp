@@ -0,0 +1,43 @@
+#ifndef OSEMU_LOCKSTEP_H_
+#define OSEMU_LOCKSTEP_H_
+
+#include <span>
+
+#include "process_control_block.hpp"
+#include "program_image.hpp"
+
+namespace osemu {
+
+// Runs copies of one program that stand at the same point in it through the
+// same instructions together. Their variables are laid out slot by slot
+// (structure of arrays), so one saturating vector add or subtract updates
+// every copy. A core running more than one instruction per tick runs ready
+// processes that share its process's image and position this way.
+constexpr size_t kLockstepLanes = 16;
+
+struct LockstepLane {
+  InstructionEvaluator* evaluator;
+};
+
+// Runs up to `budget` leaf instructions on every lane from the shared
+// `context`, like run_program, stamping PRINT records with `tick` and
+// `core`. Stops early, before the instruction, where the lanes would part
+// ways: a loop count or SLEEP that differs between them. Runs nothing for
+// an unverified program. At most kLockstepLanes lanes.
+StepResult run_lockstep(const ProgramImage& program, ExecutionContext& context,
+                        std::span<const LockstepLane> lanes, size_t budget,
+                        uint64_t tick = 0, int core = -1);
+
+// Whether `other` can run in lockstep with `lead`: the same program image,
+// the same execution context and SLEEP, and neither of them complete.
+bool lockstep_compatible(const PCB& lead, const PCB& other);
+
+// One tick of PCB::step for `group`, PCBs that are lockstep_compatible with
+// the first, on the first one's core: waits out their SLEEP, or runs up to
+// `budget` instructions in lockstep. Where the lanes part ways, each PCB
+// runs the rest of its budget on its own. At most kLockstepLanes PCBs.
+void step_lockstep(std::span<PCB* const> group, uint64_t tick, size_t budget);
+
+}
+
+#endif
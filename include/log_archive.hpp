@@ -0,0 +1,51 @@
+#ifndef OSEMU_LOG_ARCHIVE_H_
+#define OSEMU_LOG_ARCHIVE_H_
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "pcb_pool.hpp"
+
+namespace osemu {
+
+// Append-only segment file receiving the logs of finished processes, so they
+// can be released from memory but still inspected afterwards. Writing happens
+// on the archive's own thread, off the CPU workers.
+class LogArchive {
+ public:
+  ~LogArchive();
+
+  // An empty path disables spilling. The segment is truncated on open.
+  bool open(const std::string& path);
+  // Writes whatever is still queued, then closes the segment.
+  void close();
+
+  // Queues the process's logs for writing. The PCB stays pinned until they
+  // are written; when spilling is disabled the reference is dropped at once.
+  // Blocks while kMaxPending processes are already waiting, so a burst of
+  // completions cannot pin more than that many finished PCBs.
+  void spill(PcbRef pcb);
+
+  static constexpr size_t kMaxPending = 64;
+
+ private:
+  void run();
+  void write(PCB& pcb);
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::condition_variable space_cv_;
+  std::deque<PcbRef> pending_;
+  bool enabled_{false};
+  bool stopping_{false};
+  std::thread writer_;
+  std::ofstream out_;
+};
+
+}
+
+#endif
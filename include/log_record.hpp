@@ -0,0 +1,92 @@
+#ifndef OSEMU_LOG_RECORD_H_
+#define OSEMU_LOG_RECORD_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace osemu {
+
+// Texts that appear in PRINT output, interned once so that log records can
+// refer to them by id. Id 0 is the empty string.
+class MessageTable {
+ public:
+  static MessageTable& instance();
+
+  uint32_t intern(std::string_view text);
+  // The reference stays valid for the life of the program.
+  const std::string& text(uint32_t id) const;
+
+ private:
+  MessageTable();
+
+  mutable std::shared_mutex mutex_;
+  std::deque<std::string> texts_;
+  std::unordered_map<std::string_view, uint32_t> ids_;
+};
+
+// Wall-clock seconds rendered as "10/18/2026 07:24:27 PM" (UTC), for log
+// lines and process listings. The text of one second is held where every
+// core can read it without locking: the scheduler's clock refreshes it to
+// the current second once per tick, and rendering another second replaces
+// it, so a run of records from the same second is formatted once.
+class TimestampCache {
+ public:
+  static constexpr size_t kLength = 22;
+
+  static TimestampCache& instance();
+
+  // Seconds since the epoch as of the last refresh; what PRINT stamps on
+  // its records instead of reading the system clock.
+  int64_t now();
+  void refresh();
+  // Appends the text of `seconds` to `out`.
+  void append(int64_t seconds, std::string& out);
+
+ private:
+  using Text = std::array<char, kLength>;
+
+  TimestampCache() = default;
+
+  bool load(int64_t seconds, Text& text) const;
+  void store(int64_t seconds, const Text& text);
+
+  std::atomic<int64_t> now_{0};
+  // A seqlock over held_ and words_: odd while a writer is in between.
+  // Readers that catch it odd or changed format the text themselves.
+  std::atomic<uint64_t> sequence_{0};
+  std::atomic<int64_t> held_{std::numeric_limits<int64_t>::min()};
+  std::array<std::atomic<uint64_t>, (kLength + 7) / 8> words_{};
+  std::atomic_flag writing_;
+};
+
+// One PRINT, stored as fixed-size data and only rendered to text when the
+// log is viewed. The message reads lead if any, prefix, value if any, then
+// suffix; a greeting reads "Hello world from <process name>!" instead.
+struct LogRecord {
+  static constexpr uint8_t kValue = 1;
+  static constexpr uint8_t kLead = 2;
+  static constexpr uint8_t kGreeting = 4;
+
+  uint64_t tick{0};
+  int64_t time{0};  // Wall clock, in seconds since the epoch.
+  uint32_t prefix{0};
+  uint32_t suffix{0};
+  uint16_t value{0};
+  uint16_t lead{0};
+  int16_t core{-1};
+  uint8_t flags{0};
+};
+
+// "(10/18/2026 07:24:27 PM) Core:0 "Value from: 5"".
+std::string to_string(const LogRecord& record, std::string_view process_name);
+
+}
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef OSEMU_PCB_POOL_H_
+#define OSEMU_PCB_POOL_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "process_control_block.hpp"
+
+namespace osemu {
+
+class PcbPool;
+
+// Generational 32-bit reference to a PCB in a PcbPool: the low bits select the
+// slot, the high bits must match the slot's generation. Once the process is
+// released its handles stop resolving, even after the slot is reused (until
+// the generation wraps around). A zero handle refers to nothing.
+class PcbHandle {
+ public:
+  static constexpr uint32_t kIndexBits = 20;
+  static constexpr uint32_t kIndexMask = (1u << kIndexBits) - 1;
+  static constexpr uint32_t kMaxGeneration = (1u << (32 - kIndexBits)) - 1;
+
+  constexpr PcbHandle() = default;
+  static constexpr PcbHandle from_raw(uint32_t raw) { return PcbHandle(raw); }
+
+  uint32_t raw() const { return raw_; }
+  uint32_t index() const { return raw_ & kIndexMask; }
+  uint32_t generation() const { return raw_ >> kIndexBits; }
+
+  explicit operator bool() const { return raw_ != 0; }
+  bool operator==(const PcbHandle& other) const = default;
+
+ private:
+  friend class PcbPool;
+  constexpr explicit PcbHandle(uint32_t raw) : raw_(raw) {}
+
+  uint32_t raw_{0};
+};
+
+// Pins a PCB for an observer so it cannot be destroyed while in use, even if
+// the process finishes and is released in the meantime.
+class PcbRef {
+ public:
+  PcbRef() = default;
+  PcbRef(PcbRef&& other) noexcept;
+  PcbRef& operator=(PcbRef&& other) noexcept;
+  PcbRef(const PcbRef&) = delete;
+  PcbRef& operator=(const PcbRef&) = delete;
+  ~PcbRef();
+
+  PCB* get() const { return pcb_; }
+  PCB* operator->() const { return pcb_; }
+  PCB& operator*() const { return *pcb_; }
+  explicit operator bool() const { return pcb_ != nullptr; }
+
+ private:
+  friend class PcbPool;
+  PcbRef(PcbPool* pool, uint32_t index, PCB* pcb)
+      : pool_(pool), index_(index), pcb_(pcb) {}
+
+  PcbPool* pool_{nullptr};
+  uint32_t index_{0};
+  PCB* pcb_{nullptr};
+};
+
+// Slab allocator for PCBs. Slots are recycled through a free list, so
+// creating a process does not allocate once the pool has warmed up. The
+// scheduler owns each process from create() to release() and reaches it with
+// get(); everyone else goes through acquire().
+class PcbPool {
+ public:
+  static constexpr size_t kSlabSize = 1024;
+  static constexpr size_t kMaxSlabs = (size_t{1} << PcbHandle::kIndexBits) / kSlabSize;
+
+  PcbPool() = default;
+  ~PcbPool();
+  PcbPool(const PcbPool&) = delete;
+  PcbPool& operator=(const PcbPool&) = delete;
+
+  // Returns an empty handle when every slot is in use.
+  template <typename... Args>
+  PcbHandle create(Args&&... args);
+
+  // Owner access, valid from create() until release().
+  PCB& get(PcbHandle handle) const { return *slot(handle.index()).pcb(); }
+
+  // Empty if the handle is stale.
+  PcbRef acquire(PcbHandle handle) const;
+
+  // Drops the owner's reference. The PCB is destroyed and the slot recycled
+  // as soon as no PcbRef pins it.
+  void release(PcbHandle handle) { unref(handle.index()); }
+
+ private:
+  friend class PcbRef;
+
+  struct Slot {
+    alignas(PCB) std::byte storage[sizeof(PCB)];
+    std::atomic<uint32_t> generation{1};
+    // Owner reference plus one per PcbRef; zero when the slot is free.
+    std::atomic<uint32_t> refs{0};
+
+    PCB* pcb() { return std::launder(reinterpret_cast<PCB*>(storage)); }
+  };
+
+  struct Slab {
+    std::array<Slot, kSlabSize> slots;
+  };
+
+  Slot& slot(uint32_t index) const {
+    return slab_directory_[index / kSlabSize].load(std::memory_order_acquire)
+        ->slots[index % kSlabSize];
+  }
+  bool allocate_slot(uint32_t& index);
+  void free_slot(uint32_t index);
+  void unref(uint32_t index);
+
+  std::mutex free_mutex_;
+  std::vector<uint32_t> free_slots_;
+  std::vector<std::unique_ptr<Slab>> slabs_;
+  std::array<std::atomic<Slab*>, kMaxSlabs> slab_directory_{};
+};
+
+template <typename... Args>
+PcbHandle PcbPool::create(Args&&... args) {
+  uint32_t index;
+  if (!allocate_slot(index)) {
+    return PcbHandle();
+  }
+
+  Slot& s = slot(index);
+  try {
+    new (s.storage) PCB(std::forward<Args>(args)...);
+  } catch (...) {
+    free_slot(index);
+    throw;
+  }
+  uint32_t generation = s.generation.load(std::memory_order_relaxed);
+  s.refs.store(1, std::memory_order_release);
+  return PcbHandle((generation << PcbHandle::kIndexBits) | index);
+}
+
+}
+
+#endif
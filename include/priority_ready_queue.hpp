@@ -0,0 +1,127 @@
+#ifndef OSEMU_PRIORITY_READY_QUEUE_H_
+#define OSEMU_PRIORITY_READY_QUEUE_H_
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+// FIFO per priority level plus a bitmap of non-empty levels, so finding the
+// highest-priority entry is a single countr_zero. Level 0 is the highest.
+template <typename T, size_t Levels = 32>
+class PriorityReadyQueue {
+  static_assert(Levels <= 32, "level bitmap is a uint32_t");
+
+ public:
+  static constexpr int kNone = -1;
+
+  // Pushes at the level `level` holds, read under the queue lock so that a
+  // concurrent relevel() either sees the entry queued or is seen here.
+  template <typename Level>
+  void push(T value, const std::atomic<Level>& level) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t at = level.load();
+    levels_[at].push_back(std::move(value));
+    mark(at);
+    size_++;
+    cond_.notify_one();
+  }
+
+  void shutdown() {
+    shutdown_requested_ = true;
+    cond_.notify_all();
+  }
+
+  bool wait_and_pop(T& value) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this] {
+      return non_empty_ != 0 || shutdown_requested_.load();
+    });
+
+    if (non_empty_ == 0) {
+      return false;
+    }
+
+    size_t level = std::countr_zero(non_empty_);
+    value = std::move(levels_[level].front());
+    levels_[level].pop_front();
+    if (levels_[level].empty()) {
+      non_empty_ &= ~(1u << level);
+    }
+    size_--;
+    return true;
+  }
+
+  // Stores `to` in `level` and, if the entry is queued, moves it there, both
+  // under the queue lock. Returns false when the entry is not queued (e.g.
+  // it is running and will be pushed at the new level).
+  template <typename Level>
+  bool relevel(const T& value, std::atomic<Level>& level, Level to) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t from = level.exchange(to);
+    if (from == to) {
+      return false;
+    }
+    auto& src = levels_[from];
+    for (auto it = src.begin(); it != src.end(); ++it) {
+      if (*it == value) {
+        levels_[to].push_back(std::move(*it));
+        src.erase(it);
+        if (src.empty()) {
+          non_empty_ &= ~(1u << from);
+        }
+        mark(to);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Moves up to `max` entries queued at `level` for which `pred` holds,
+  // oldest first, to `out`. Returns how many it took.
+  template <typename Pred, typename Out>
+  size_t take_if(size_t level, size_t max, Pred pred, Out out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& queue = levels_[level];
+    size_t taken = 0;
+    for (auto it = queue.begin(); it != queue.end() && taken < max;) {
+      if (pred(*it)) {
+        *out++ = std::move(*it);
+        it = queue.erase(it);
+        taken++;
+      } else {
+        ++it;
+      }
+    }
+    if (queue.empty()) {
+      non_empty_ &= ~(1u << level);
+    }
+    size_ -= taken;
+    return taken;
+  }
+
+  int highest_level() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return non_empty_ == 0 ? kNone : std::countr_zero(non_empty_);
+  }
+
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+  }
+
+ private:
+  void mark(size_t level) { non_empty_ |= (1u << level); }
+
+  mutable std::mutex mutex_;
+  std::array<std::deque<T>, Levels> levels_;
+  uint32_t non_empty_{0};
+  size_t size_{0};
+  std::condition_variable cond_;
+  std::atomic_bool shutdown_requested_{false};
+};
+
+#endif
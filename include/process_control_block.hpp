@@ -3,27 +3,75 @@
 
 #include <chrono>
 #include <memory>
-#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include "instruction_parser.hpp"
+#include "program_image.hpp"
 #include <atomic>
 
 namespace osemu {
 
-class PCB : public std::enable_shared_from_this<PCB> {
+// Lifecycle of a process. Only the scheduler and the core running the
+// process write it; anyone may read it without locking.
+enum class ProcessState : uint8_t { New, Ready, Running, Sleeping, Finished };
+
+const char* to_string(ProcessState state);
+
+// "512 B", "12.5 KiB", "3.0 MiB".
+std::string format_bytes(size_t bytes);
+
+// Host memory attributed to a process. The program image is shared by every
+// process running it, so it is reported apart from what the process owns.
+struct MemoryUsage {
+  size_t control{0};
+  size_t variables{0};
+  size_t logs{0};
+  size_t program{0};
+
+  size_t owned() const { return control + variables + logs; }
+};
+
+// What is kept of a process once it finishes: enough for screen -ls and
+// report-util, without its program, variables or logs.
+struct ProcessSummary {
+  uint32_t processID{0};
+  std::string processName;
+  std::chrono::system_clock::time_point creationTime;
+  std::chrono::system_clock::time_point finishTime;
+  size_t totalInstructions{0};
+
+  std::string status() const;
+};
+
+class PCB {
  public:
-  PCB(std::string procName, size_t totalLines);
-  PCB(std::string procName, const std::vector<Expr>& instructions);
+  static constexpr uint8_t kHighestPriority = 0;
+  static constexpr uint8_t kLowestPriority = 31;
+  static constexpr uint8_t kDefaultPriority = 16;
+  static constexpr int kNoCore = -1;
+
+  PCB(std::string procName, ProgramImagePtr program,
+      uint8_t priority = kDefaultPriority);
   static std::atomic<uint32_t> next_pid;
+  // Parses `text`, all of it, as a priority from kHighestPriority to
+  // kLowestPriority.
+  static bool parsePriority(std::string_view text, uint8_t& priority);
 
-  void step();
+  // Runs up to `budget` instructions on `tick`, or waits out one tick of a
+  // SLEEP.
+  void step(uint64_t tick = 0, size_t budget = 1);
   bool isComplete() const;
   std::string status() const;
+  ProcessSummary summarize() const;
+  MemoryUsage memoryUsage() const;
   
   
-  bool executeCurrentInstruction();
-  const std::vector<std::string>& getExecutionLogs() const;
+  bool executeCurrentInstruction(size_t budget = 1);
+  // Applies the outcome of running the program from `context`: progress,
+  // the total's correction, any SLEEP and the first fault.
+  void recordProgress(const StepResult& result);
+  const ProcessLog& getExecutionLogs() const;
   
   
   void setSleepCycles(uint16_t cycles);
@@ -32,18 +80,27 @@ class PCB : public std::enable_shared_from_this<PCB> {
 
   uint32_t processID;
   std::string processName;
-  size_t currentInstruction;
-  size_t totalInstructions;
+  // Progress in leaf instructions, FOR bodies unrolled. The total grows or
+  // shrinks when a loop whose count is a variable starts.
+  std::atomic<size_t> currentInstruction;
+  std::atomic<size_t> totalInstructions;
   std::chrono::system_clock::time_point creationTime;
+  std::atomic<uint8_t> priority;
 
   
-  std::optional<int> assignedCore;
+  std::atomic<ProcessState> state;
+  std::atomic<int> assignedCore;
   std::chrono::system_clock::time_point finishTime;
   
   
-  std::vector<Expr> instructions;
+  ProgramImagePtr program;
+  ExecutionContext context;
   InstructionEvaluator evaluator;
   uint16_t sleepCyclesRemaining;
+  // The first malformed instruction the process ran, if any, and its
+  // position in leaf instructions. faultInstruction is written first.
+  std::atomic<Fault> fault{Fault::kNone};
+  std::atomic<size_t> faultInstruction{0};
 };
 
 }  
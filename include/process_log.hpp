@@ -0,0 +1,114 @@
+#ifndef OSEMU_PROCESS_LOG_H_
+#define OSEMU_PROCESS_LOG_H_
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <istream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "log_record.hpp"
+
+namespace osemu {
+
+// Heap memory owned by a string, not counting the string object itself.
+size_t heap_bytes(const std::string& s);
+
+// Append-only file shared by all processes, receiving the log lines that
+// overflow their in-memory ring. Records are written in blocks, as a text
+// header followed by the raw records, and are buffered until a reader needs
+// them. Each block
+// records the offset of the previous block of the same process, so a process
+// only has to remember its latest block to find all of its lines again.
+class LogSpillFile {
+ public:
+  struct Block {
+    size_t first{0};       // Sequence number of the first line.
+    int64_t previous{-1};  // Offset of the process's previous block.
+    std::vector<LogRecord> lines;
+  };
+
+  // An empty path disables spilling. The file is opened once, for appending,
+  // and stays open for the life of the emulator so that the offsets held by
+  // live processes remain valid; later calls are no-ops.
+  bool open(const std::string& path);
+  bool enabled() const { return enabled_.load(std::memory_order_acquire); }
+  std::string path() const;
+
+  // Returns the offset of the written block, or -1.
+  int64_t write(uint32_t pid, const Block& block);
+  // Makes every written block visible to readers of path().
+  void flush();
+  // Reads the header of the block at `offset` in a stream opened on path(),
+  // and its lines too unless `with_lines` is false.
+  static bool read(std::istream& in, int64_t offset, Block& block, size_t& count,
+                   bool with_lines = true);
+
+ private:
+  mutable std::mutex mutex_;
+  std::string path_;
+  std::vector<char> buffer_;
+  std::ofstream out_;
+  int64_t size_{0};
+  std::atomic<bool> enabled_{false};
+};
+
+// Execution log of one process, one record per line. With a capacity, at
+// most that many lines are kept in memory, in a ring allocated as lines
+// arrive: the oldest half moves to the spill file when the ring is
+// full, or the oldest line is dropped when there is no spill file. Lines are
+// numbered from 0 in order of appending, wherever they end up.
+class ProcessLog {
+ public:
+  // 0 keeps every line in memory. Call before the first append.
+  void configure(size_t capacity, LogSpillFile* spill, uint32_t pid);
+
+  void append(const LogRecord& line);
+  // Frees the lines held in memory and forgets the spilled ones, once
+  // they have been archived elsewhere.
+  void discard();
+
+  // Lines appended so far, including spilled and dropped ones.
+  size_t size() const;
+  // Bytes held in memory.
+  size_t memory_bytes() const { return bytes_.load(std::memory_order_relaxed); }
+
+  // Calls `fn` for each line in [first, first + count) still available,
+  // reading spilled lines back from the file. Safe while lines are appended.
+  void read(size_t first, size_t count,
+            const std::function<void(const LogRecord&)>& fn) const;
+  void for_each(const std::function<void(const LogRecord&)>& fn) const {
+    read(0, size(), fn);
+  }
+
+ private:
+  void spill_oldest(size_t count);
+  LogRecord& slot(size_t seq) {
+    return lines_[capacity_ > 0 ? seq % capacity_ : seq];
+  }
+  const LogRecord& slot(size_t seq) const {
+    return lines_[capacity_ > 0 ? seq % capacity_ : seq];
+  }
+
+  mutable std::mutex mutex_;
+  // Ring of the newest lines; line `seq` lives at lines_[seq % capacity].
+  // Without a capacity it simply grows.
+  std::vector<LogRecord> lines_;
+  size_t capacity_{0};
+  size_t total_{0};
+  size_t first_in_memory_{0};
+  // Lines [spill_begin_, first_in_memory_) are in the spill file; anything
+  // before spill_begin_ was dropped.
+  size_t spill_begin_{0};
+  int64_t last_block_{-1};
+  LogSpillFile* spill_{nullptr};
+  uint32_t pid_{0};
+  std::atomic<size_t> bytes_{0};
+};
+
+}
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef OSEMU_PROCESS_TABLE_H_
+#define OSEMU_PROCESS_TABLE_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+#include "pcb_pool.hpp"
+
+namespace osemu {
+
+// Process lookup by name and by PID, yielding pool handles. Both indexes are split into shards with
+// their own reader/writer lock, so lookups only contend with inserts that
+// hash to the same shard. for_each copies one shard at a time and runs the
+// callback without holding any lock.
+class ProcessTable {
+ public:
+  static constexpr size_t kShardCount = 16;
+
+  // Fails without modifying the table if the name is already taken.
+  bool insert(const std::string& name, uint32_t pid, PcbHandle handle);
+  // Only removes the entries if they still refer to `handle`.
+  bool erase(const std::string& name, uint32_t pid, PcbHandle handle);
+
+  PcbHandle find_by_name(const std::string& name) const;
+  PcbHandle find_by_pid(uint32_t pid) const;
+
+  size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+  void for_each(const std::function<void(PcbHandle)>& fn) const;
+
+ private:
+  template <typename Key>
+  struct alignas(64) Shard {
+    mutable std::shared_mutex mutex;
+    std::unordered_map<Key, PcbHandle> entries;
+  };
+
+  Shard<std::string>& name_shard(const std::string& name);
+  const Shard<std::string>& name_shard(const std::string& name) const;
+  Shard<uint32_t>& pid_shard(uint32_t pid) { return by_pid_[pid % kShardCount]; }
+  const Shard<uint32_t>& pid_shard(uint32_t pid) const {
+    return by_pid_[pid % kShardCount];
+  }
+
+  std::array<Shard<std::string>, kShardCount> by_name_;
+  std::array<Shard<uint32_t>, kShardCount> by_pid_;
+  std::atomic<size_t> size_{0};
+};
+
+}
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef OSEMU_PROGRAM_IMAGE_H_
+#define OSEMU_PROGRAM_IMAGE_H_
+
+#include <array>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "bytecode.hpp"
+#include "instruction_parser.hpp"
+
+namespace osemu {
+
+using CodeScratch = std::array<Instruction, 2>;
+
+// Instructions of a program, shared read-only by every PCB running it.
+// Per-process state (PC, variables, logs) stays in the PCB.
+//
+// An image is either materialized (parsed from a file and compiled to
+// bytecode once) or generated: a seed and an instruction count from which
+// any instruction can be rebuilt on demand, so a generated program costs the
+// same memory at any length.
+class ProgramImage {
+ public:
+  explicit ProgramImage(const std::vector<Expr>& instructions);
+  ProgramImage(uint64_t seed, size_t count);
+
+  size_t size() const { return size_; }
+  // Instructions a run executes with FOR bodies unrolled; see
+  // Bytecode::flat_size.
+  size_t flat_size() const { return generated_ ? size_ : bytecode_.flat_size(); }
+  // Whether the code passed verify() when the image was built. Generated
+  // segments come from fixed templates and always do.
+  bool is_verified() const { return verified_; }
+  // The first source instruction that could not be compiled; see
+  // Bytecode::fault.
+  size_t fault_instruction() const { return bytecode_.fault_instruction(); }
+  Fault fault() const { return bytecode_.fault(); }
+  // Host memory held by the image, shared by every process running it.
+  size_t memory_bytes() const { return memory_bytes_; }
+
+  // Code runs in segments, within which jumps and superinstructions work.
+  // A materialized program is a single segment; a generated one is encoded
+  // into `scratch` one PRINT/ADD pair at a time. Variable operands index
+  // names().
+  size_t segment_count() const;
+  std::span<const Instruction> segment(size_t index, CodeScratch& scratch) const;
+  const std::vector<std::string>& names() const;
+
+ private:
+  uint16_t generated_add_value(size_t index) const;
+
+  const bool generated_{false};
+  const uint64_t seed_{0};
+  const size_t size_{0};
+  bool verified_{false};
+  Bytecode bytecode_;
+  uint32_t print_message_{0};
+  size_t memory_bytes_{0};
+};
+
+using ProgramImagePtr = std::shared_ptr<const ProgramImage>;
+
+// Runs up to `budget` leaf instructions of `program` from `context`, moving
+// on through segments as each one ends. Stops early after a SLEEP, or at
+// the end of the program (context.pc == program.segment_count()). An unverified program is not run: it ends at
+// once with Fault::kUnverifiedProgram.
+StepResult run_program(const ProgramImage& program, ExecutionContext& context,
+                       InstructionEvaluator& evaluator, size_t budget = 1);
+
+// Parsed .opesy files keyed by path. An entry is reused while some process
+// still holds the image and the file has not been modified since.
+class ProgramCache {
+ public:
+  ProgramImagePtr load(const std::filesystem::path& file, std::string& error);
+
+ private:
+  struct Entry {
+    std::filesystem::file_time_type modified;
+    std::weak_ptr<const ProgramImage> image;
+  };
+
+  std::mutex mutex_;
+  std::unordered_map<std::string, Entry> entries_;
+};
+
+}
+
+#endif
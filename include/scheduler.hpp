@@ -3,21 +3,46 @@
 
 #include <atomic>
 #include <memory>
+#include <ostream>
 #include <mutex>
 #include <thread>
-#include <vector>
 #include <unordered_map>
+#include <vector>
+#include "pcb_pool.hpp"
 #include "process_control_block.hpp"
-#include "thread_safe_queue.hpp"
+#include "process_table.hpp"
+#include "priority_ready_queue.hpp"
+#include "snapshot_log.hpp"
 #include "instruction_generator.hpp"
 #include "config.hpp"
+#include "lockstep.hpp"
+#include "log_archive.hpp"
 
 namespace osemu {
 
 class Config;
 
+enum class SubmitResult { Admitted, Rejected, NameTaken };
+
 class Scheduler {
  public:
+  using FinishedLog = SnapshotLog<ProcessSummary>;
+
+  // Point-in-time view of the process lists for observers. Capturing it
+  // takes no scheduler lock and it can be formatted at leisure.
+  struct StatusSnapshot {
+    size_t total_cores{0};
+    size_t cores_used{0};
+    double cpu_utilization{0.0};
+    std::vector<PcbRef> running;
+    FinishedLog::View finished;
+    size_t evicted{0};
+    // Memory of live processes; each distinct program image counted once.
+    size_t live_processes{0};
+    size_t process_bytes{0};
+    size_t program_bytes{0};
+  };
+
   Scheduler();
   ~Scheduler();
 
@@ -27,8 +52,13 @@ class Scheduler {
   void start(const Config& config);
   void stop();
 
-  void submit_process(std::shared_ptr<PCB> pcb);
+  // Creates the process and queues it, unless admission is closed or the
+  // name is already in use.
+  SubmitResult submit_process(std::string name, ProgramImagePtr program,
+                              uint8_t priority = PCB::kDefaultPriority);
+  bool renice(const std::string& name, uint8_t priority);
   void print_status() const;
+  StatusSnapshot snapshot() const;
 
   
   void start_batch_generation(const Config& config);
@@ -36,7 +66,8 @@ class Scheduler {
   void calculate_cpu_utilization(size_t& total_cores, size_t& cores_used,
                                  double& cpu_utilization) const;
   bool is_generating() const { return batch_generating_; }
-  std::shared_ptr<PCB> find_process_by_name(const std::string& name) const;
+  PcbRef find_process_by_name(const std::string& name) const;
+  PcbRef find_process_by_pid(uint32_t pid) const;
   
   void generate_report(const std::string& filename = "csopesy-log.txt") const;
 
@@ -45,26 +76,51 @@ class Scheduler {
  private:
   friend class CPUWorker;
   class CPUWorker;
-  void move_to_running(std::shared_ptr<PCB> pcb);
-  void move_to_finished(std::shared_ptr<PCB> pcb);
-  void move_to_ready(std::shared_ptr<PCB> pcb);
+  // Names the process pNN from the next free batch number. False, with
+  // nothing counted, when admission is closed.
+  bool submit_batch_process(ProgramImagePtr program);
+  // Call with admission_mutex_ held.
+  bool admission_open() const;
+  void enqueue_admitted(PcbHandle process);
+  void move_to_running(int core_id, PcbHandle process);
+  // Shows `process` as running in lockstep with the one in the core's slot.
+  void move_to_lockstep(int core_id, PcbHandle process);
+  // Empties whichever of the core's slots shows `process`.
+  void vacate(int core_id, PcbHandle process);
+  void move_to_finished(int core_id, PcbHandle process);
+  void move_to_ready(int core_id, PcbHandle process);
+  std::vector<PcbRef> running_snapshot() const;
+  void write_admission_stats(std::ostream& out) const;
+  void preempt_for(uint8_t priority);
+  void write_evicted_note(std::ostream& out, const StatusSnapshot& snap) const;
+  void write_memory_stats(std::ostream& out, const StatusSnapshot& snap) const;
   
   std::atomic<int> cores_ready_for_next_tick_{0};
   int total_cores_{0};
 
+  // Owns every live PCB; the queue, table and core slots below only hold
+  // handles into it.
+  PcbPool pcb_pool_;
+
   std::atomic<bool> running_;
   std::vector<std::unique_ptr<CPUWorker>> cpu_workers_;
 
-  ThreadSafeQueue<std::shared_ptr<PCB>> ready_queue_;
-
-  mutable std::mutex running_mutex_;
-  mutable std::mutex finished_mutex_;
+  PriorityReadyQueue<PcbHandle, PCB::kLowestPriority + 1> ready_queue_;
 
-  mutable std::mutex map_mutex_;
-  std::unordered_map<std::string, std::shared_ptr<PCB>> all_processes_map_;
+  ProcessTable process_table_;
 
-  std::vector<std::shared_ptr<PCB>> running_processes_;
-  std::vector<std::shared_ptr<PCB>> finished_processes_;
+  // One slot per core holding the raw handle of the PCB it is running, or 0
+  // when idle. Only the owning core writes its slot; observers read them
+  // without taking any scheduler lock and pin the PCB through the pool.
+  std::vector<std::atomic<uint32_t>> core_slots_;
+  // kLockstepLanes - 1 per core, in core order, for the processes running
+  // in lockstep with the one in its slot; written the same way.
+  std::vector<std::atomic<uint32_t>> lane_slots_;
+  FinishedLog finished_processes_;
+  LogArchive log_archive_;
+  LogSpillFile log_spill_;
+  size_t log_buffer_lines_{0};
+  size_t max_finished_records_{0};
 
   std::thread dispatch_thread_;
 
@@ -72,8 +128,7 @@ class Scheduler {
   std::atomic<bool> batch_generating_;
   std::unique_ptr<std::thread> batch_generator_thread_;
   InstructionGenerator instruction_generator_;
-  int process_counter_;
-  mutable std::mutex process_counter_mutex_;
+  std::atomic<uint32_t> batch_name_counter_{0};
   
   std::atomic<size_t> ticks_{0}; 
   mutable std::mutex clock_mutex_; 
@@ -83,9 +138,28 @@ class Scheduler {
   
   size_t batch_process_freq_{1};
   size_t delay_per_exec_{0};
+  size_t ins_per_tick_{1};
   size_t quantum_cycles_{5};
   SchedulingAlgorithm algorithm_{SchedulingAlgorithm::FCFS};
 
+  size_t max_ready_queue_{0};
+  size_t max_live_processes_{0};
+  uint64_t max_resident_instructions_{0};
+  AdmissionPolicy admission_policy_{AdmissionPolicy::Defer};
+
+  // Held from the admission check until the arrival is charged, so each
+  // arrival is admitted or turned away by a single check.
+  std::mutex admission_mutex_;
+  std::atomic<size_t> live_processes_{0};
+  // Instructions of the programs live processes run, each image counted
+  // once however many processes share it.
+  std::atomic<uint64_t> resident_instructions_{0};
+  std::mutex resident_mutex_;
+  std::unordered_map<const ProgramImage*, size_t> resident_programs_;
+  std::atomic<size_t> admitted_arrivals_{0};
+  std::atomic<size_t> deferred_arrivals_{0};
+  std::atomic<size_t> rejected_arrivals_{0};
+
 };
 
 }  
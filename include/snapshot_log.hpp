@@ -0,0 +1,115 @@
+#ifndef OSEMU_SNAPSHOT_LOG_H_
+#define OSEMU_SNAPSHOT_LOG_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Append-only log whose readers never block writers. Entries live in fixed
+// chunks that are never moved; the list of chunks is an immutable index that
+// writers replace (copy + publish) only when a chunk fills up or old chunks
+// are trimmed. A snapshot pins the current index and entry range, so it stays
+// valid and unchanged however long the reader takes, while writers keep
+// appending past its end and trimming before its start.
+template <typename T, size_t ChunkSize = 1024>
+class SnapshotLog {
+  struct Chunk {
+    std::array<T, ChunkSize> entries;
+  };
+
+  struct Index {
+    size_t base{0};  // Position of the first entry of chunks[0].
+    std::vector<std::shared_ptr<Chunk>> chunks;
+  };
+
+ public:
+  class View {
+   public:
+    size_t size() const { return end_ - begin_; }
+    bool empty() const { return begin_ == end_; }
+
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+      for (size_t pos = begin_; pos < end_; ++pos) {
+        size_t offset = pos - index_->base;
+        fn(index_->chunks[offset / ChunkSize]->entries[offset % ChunkSize]);
+      }
+    }
+
+   private:
+    friend class SnapshotLog;
+    std::shared_ptr<const Index> index_;
+    size_t begin_{0};
+    size_t end_{0};
+  };
+
+  SnapshotLog() : index_(std::make_shared<const Index>()) {}
+
+  void append(T value) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    size_t pos = end_.load(std::memory_order_relaxed);
+    std::shared_ptr<const Index> index = index_.load(std::memory_order_relaxed);
+    size_t offset = pos - index->base;
+    if (offset == index->chunks.size() * ChunkSize) {
+      auto grown = std::make_shared<Index>(*index);
+      grown->chunks.push_back(std::make_shared<Chunk>());
+      index = grown;
+      index_.store(index, std::memory_order_release);
+    }
+    index->chunks[offset / ChunkSize]->entries[offset % ChunkSize] = std::move(value);
+    end_.store(pos + 1, std::memory_order_release);
+  }
+
+  View snapshot() const {
+    View view;
+    // Load the count first: the index published before it always covers it.
+    view.end_ = end_.load(std::memory_order_acquire);
+    view.index_ = index_.load(std::memory_order_acquire);
+    view.begin_ = std::min(
+        std::max(view.index_->base, begin_.load(std::memory_order_acquire)),
+        view.end_);
+    return view;
+  }
+
+  // Drops the oldest entries so that at most `max_entries` remain. A chunk is
+  // freed once it is wholly trimmed and no snapshot references it.
+  void trim(size_t max_entries) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    size_t end = end_.load(std::memory_order_relaxed);
+    size_t begin = begin_.load(std::memory_order_relaxed);
+    if (end - begin <= max_entries) {
+      return;
+    }
+    begin = end - max_entries;
+    begin_.store(begin, std::memory_order_release);
+
+    std::shared_ptr<const Index> index = index_.load(std::memory_order_relaxed);
+    size_t whole_chunks = (begin - index->base) / ChunkSize;
+    if (whole_chunks > 0) {
+      auto trimmed = std::make_shared<Index>();
+      trimmed->base = index->base + whole_chunks * ChunkSize;
+      trimmed->chunks.assign(index->chunks.begin() + whole_chunks,
+                             index->chunks.end());
+      index_.store(std::move(trimmed), std::memory_order_release);
+    }
+  }
+
+  size_t size() const {
+    return end_.load(std::memory_order_acquire) -
+           begin_.load(std::memory_order_acquire);
+  }
+
+  // Number of entries dropped by trim() so far.
+  size_t trimmed() const { return begin_.load(std::memory_order_acquire); }
+
+ private:
+  std::mutex write_mutex_;
+  std::atomic<std::shared_ptr<const Index>> index_;
+  std::atomic<size_t> begin_{0};
+  std::atomic<size_t> end_{0};
+};
+
+#endif
@@ -0,0 +1,684 @@
+#include "bytecode.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <unordered_map>
+
+#include "log_record.hpp"
+
+namespace osemu {
+
+namespace {
+
+// Leaf counts saturate rather than wrap; a program that large never
+// finishes either way.
+uint32_t saturating_add(uint32_t a, uint64_t b) {
+  return static_cast<uint32_t>(
+      std::min<uint64_t>(a + b, std::numeric_limits<uint32_t>::max()));
+}
+
+// The superinstruction that runs `first` and then `second`, or first's own
+// opcode when the pair is not fused.
+OpCode fused(const Instruction& first, const Instruction& second) {
+  OpCode a = first_half(first.op);
+  OpCode b = first_half(second.op);
+  if (a == OpCode::kPrint && b == OpCode::kAdd) {
+    return OpCode::kPrintAdd;
+  }
+  if (a == OpCode::kAdd && b == OpCode::kPrint && second.b.kind == Operand::kVariable &&
+      second.b.value == first.dest) {
+    return OpCode::kAddPrint;
+  }
+  if (a == OpCode::kDeclare && b == OpCode::kAdd) {
+    return OpCode::kDeclareAdd;
+  }
+  return a;
+}
+
+constexpr size_t kMaxClosedFormVariables = 16;
+
+bool is_slot(const Operand& op, uint16_t slot) {
+  return op.kind == Operand::kVariable && op.value == slot;
+}
+
+// A FOR body can be run in closed form when it only does arithmetic and
+// each instruction updates its destination from itself and values the body
+// never assigns. Each variable then goes through the same clamped shift,
+// x -> clamp(x + d, lo, hi), on every pass.
+bool closed_form(std::span<const Instruction> body) {
+  std::array<uint16_t, kMaxClosedFormVariables> assigned;
+  size_t count = 0;
+  for (const auto& in : body) {
+    OpCode op = first_half(in.op);
+    if (op == OpCode::kNop) {
+      continue;
+    }
+    if (op != OpCode::kDeclare && op != OpCode::kAdd && op != OpCode::kSub) {
+      return false;
+    }
+    if (std::find(assigned.begin(), assigned.begin() + count, in.dest) ==
+        assigned.begin() + count) {
+      if (count == assigned.size()) {
+        return false;
+      }
+      assigned[count++] = in.dest;
+    }
+  }
+  auto invariant = [&](const Operand& op) {
+    return op.kind != Operand::kVariable ||
+           std::find(assigned.begin(), assigned.begin() + count, op.value) ==
+               assigned.begin() + count;
+  };
+
+  for (const auto& in : body) {
+    bool ok = false;
+    switch (first_half(in.op)) {
+      case OpCode::kNop:
+        ok = true;
+        break;
+      case OpCode::kDeclare:
+        ok = invariant(in.b) || is_slot(in.b, in.dest);
+        break;
+      case OpCode::kAdd:
+        ok = (invariant(in.a) || is_slot(in.a, in.dest)) && invariant(in.b);
+        ok = ok || (is_slot(in.b, in.dest) && invariant(in.a));
+        break;
+      case OpCode::kSub:
+        ok = (invariant(in.a) || is_slot(in.a, in.dest)) && invariant(in.b);
+        break;
+      default:
+        break;
+    }
+    if (!ok) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Applies `passes` passes of a body accepted by closed_form().
+void run_closed_form(std::span<const Instruction> body, uint16_t passes,
+                     InstructionEvaluator& evaluator) {
+  struct Shift {
+    uint16_t slot;
+    int64_t d;
+    int64_t lo;
+    int64_t hi;
+  };
+  std::array<Shift, kMaxClosedFormVariables> shifts;
+  size_t count = 0;
+
+  auto load = [&](const Operand& op) -> int64_t {
+    return op.kind == Operand::kVariable ? evaluator.load_slot(op.value) : op.value;
+  };
+  auto clamp = [](int64_t v, int64_t lo, int64_t hi) { return std::clamp(v, lo, hi); };
+
+  for (const auto& in : body) {
+    if (in.op == OpCode::kNop) {
+      continue;
+    }
+    Shift* f = nullptr;
+    for (size_t i = 0; i < count && !f; ++i) {
+      f = shifts[i].slot == in.dest ? &shifts[i] : nullptr;
+    }
+    if (!f) {
+      f = &(shifts[count++] = Shift{in.dest, 0, 0, 65535});
+    }
+    auto shift = [&](int64_t e) {
+      f->d += e;
+      f->lo = clamp(f->lo + e, 0, 65535);
+      f->hi = clamp(f->hi + e, 0, 65535);
+    };
+    auto set = [&](int64_t v) { f->lo = f->hi = clamp(v, 0, 65535); };
+
+    switch (first_half(in.op)) {
+      case OpCode::kDeclare:
+        if (!is_slot(in.b, in.dest)) {
+          set(load(in.b));
+        }
+        break;
+      case OpCode::kAdd:
+        if (is_slot(in.a, in.dest)) {
+          shift(load(in.b));
+        } else if (is_slot(in.b, in.dest)) {
+          shift(load(in.a));
+        } else {
+          set(load(in.a) + load(in.b));
+        }
+        break;
+      case OpCode::kSub:
+        if (is_slot(in.a, in.dest)) {
+          shift(-load(in.b));
+        } else {
+          set(load(in.a) - load(in.b));
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  // After the first pass the value is within [lo, hi], where each further
+  // pass only moves it by d until it reaches a bound.
+  for (size_t i = 0; i < count; ++i) {
+    const Shift& f = shifts[i];
+    int64_t value = clamp(evaluator.load_slot(f.slot) + f.d, f.lo, f.hi);
+    value += (passes - 1) * f.d;
+    value = f.d >= 0 ? std::min(value, f.hi) : std::max(value, f.lo);
+    evaluator.store_slot(f.slot, static_cast<uint16_t>(value));
+  }
+}
+
+// The second instruction of a pair stays where it is: jumps may land on it,
+// and a run whose budget ends after the first half resumes there.
+void fuse(std::span<Instruction> code) {
+  for (size_t i = 0; i + 1 < code.size(); ++i) {
+    code[i].op = fused(code[i], code[i + 1]);
+  }
+}
+
+}
+
+class Bytecode::Compiler {
+ public:
+  explicit Compiler(Bytecode& out) : out_(out) {}
+
+  void compile(const Expr& expr) {
+    size_t base = out_.code_.size();
+    uint32_t cost = 0;
+    ++instructions_;
+    // An instruction that cannot be encoded does nothing but report why.
+    if (Fault fault = emit(expr, 0, cost); fault != Fault::kNone) {
+      if (out_.fault_ == Fault::kNone) {
+        out_.fault_ = fault;
+        out_.fault_instruction_ = instructions_;
+      }
+      out_.code_.resize(base);
+      Instruction in;
+      in.op = OpCode::kFault;
+      in.dest = static_cast<uint16_t>(fault);
+      out_.code_.push_back(in);
+      cost = 1;
+    }
+    out_.flat_size_ = std::min<uint64_t>(uint64_t{out_.flat_size_} + cost,
+                                         std::numeric_limits<size_t>::max());
+  }
+
+ private:
+  // Appends the code of `expr` and adds its leaf instructions to `cost`.
+  Fault emit(const Expr& expr, size_t depth, uint32_t& cost) {
+    Instruction in;
+    Fault fault = Fault::kNone;
+    switch (expr.type) {
+      case Expr::DECLARE:
+        if (expr.name == 0) {
+          return Fault::kMissingOperand;
+        }
+        if ((fault = numeric(expr.lhs, in.b)) != Fault::kNone ||
+            (fault = name(expr.name, in.dest)) != Fault::kNone) {
+          return fault;
+        }
+        in.op = OpCode::kDeclare;
+        break;
+
+      case Expr::ADD:
+      case Expr::SUB:
+        if (expr.name == 0) {
+          return Fault::kMissingOperand;
+        }
+        if ((fault = numeric(expr.lhs, in.a)) != Fault::kNone ||
+            (fault = numeric(expr.rhs, in.b)) != Fault::kNone ||
+            (fault = name(expr.name, in.dest)) != Fault::kNone) {
+          return fault;
+        }
+        in.op = expr.type == Expr::ADD ? OpCode::kAdd : OpCode::kSub;
+        break;
+
+      case Expr::CALL:
+        if (expr.name_text() == "PRINT") {
+          if ((fault = print(expr, depth == 0, in)) != Fault::kNone) {
+            return fault;
+          }
+        } else if (expr.name_text() == "SLEEP") {
+          if ((fault = numeric(expr.lhs, in.b)) != Fault::kNone) {
+            return fault;
+          }
+          in.op = OpCode::kSleep;
+        } else {
+          return Fault::kUnknownFunction;
+        }
+        break;
+
+      case Expr::FOR: {
+        if (depth == kMaxLoopDepth) {
+          return Fault::kLoopTooDeep;
+        }
+        if ((fault = numeric(expr.lhs, in.b)) != Fault::kNone) {
+          return fault;
+        }
+        size_t begin = out_.code_.size();
+        in.op = OpCode::kLoopBegin;
+        out_.code_.push_back(in);
+        uint32_t body_cost = 0;
+        for (const auto& child : expr.body) {
+          if ((fault = emit(child, depth + 1, body_cost)) != Fault::kNone) {
+            return fault;
+          }
+        }
+        Instruction end;
+        end.op = OpCode::kLoopEnd;
+        end.jump = static_cast<uint32_t>(begin + 1);
+        out_.code_[begin].jump = static_cast<uint32_t>(out_.code_.size());
+        out_.code_[begin].body_cost = body_cost;
+        std::span<const Instruction> loop_body(out_.code_.begin() + begin + 1,
+                                               out_.code_.end());
+        if (!loop_body.empty() && closed_form(loop_body)) {
+          out_.code_[begin].flags |= Instruction::kClosedForm;
+        }
+        out_.code_.push_back(end);
+        // A variable count is not known yet; assume one pass.
+        uint64_t passes = in.b.kind == Operand::kConstant ? in.b.value : 1;
+        cost = saturating_add(cost, passes * body_cost);
+        return Fault::kNone;
+      }
+
+      case Expr::CONSTANT:
+      case Expr::VOID_EXPR:
+        // Takes its tick inside a FOR body just as at top level.
+        break;
+
+      default:
+        return Fault::kUnknownInstruction;
+    }
+    out_.code_.push_back(in);
+    cost = saturating_add(cost, 1);
+    return Fault::kNone;
+  }
+
+  Fault print(const Expr& expr, bool top_level, Instruction& in) {
+    in.op = OpCode::kPrint;
+    if (!expr.rhs) {
+      const Atom& arg = expr.lhs;
+      if (arg.type != Atom::STRING) {
+        return numeric(arg, in.b);
+      }
+      // Id 0 is the empty string.
+      if (arg.string_id == 0 && top_level) {
+        in.flags |= Instruction::kGreeting;
+      } else {
+        in.prefix = arg.string_id;
+      }
+      return Fault::kNone;
+    }
+    if (!expr.lhs) {
+      return Fault::kMissingOperand;
+    }
+
+    Fault fault = Fault::kNone;
+    if (expr.lhs.type == Atom::STRING) {
+      in.prefix = expr.lhs.string_id;
+    } else if ((fault = numeric(expr.lhs, in.a)) != Fault::kNone) {
+      return fault;
+    }
+    if (expr.rhs.type == Atom::STRING) {
+      in.suffix = expr.rhs.string_id;
+    } else if ((fault = numeric(expr.rhs, in.b)) != Fault::kNone) {
+      return fault;
+    }
+    // A single value always goes in b; a goes first when there are two.
+    if (in.a.kind != Operand::kNone && in.b.kind == Operand::kNone) {
+      std::swap(in.a, in.b);
+    }
+    return Fault::kNone;
+  }
+
+  Fault numeric(const Atom& atom, Operand& op) {
+    switch (atom.type) {
+      case Atom::NUMBER:
+        op = Operand::constant(atom.number_value);
+        return Fault::kNone;
+      case Atom::NAME: {
+        uint16_t index = 0;
+        Fault fault = name(atom.string_id, index);
+        if (fault == Fault::kNone) {
+          op = Operand::variable(index);
+        }
+        return fault;
+      }
+      case Atom::STRING:
+        return Fault::kNotNumeric;
+      default:
+        return Fault::kMissingOperand;
+    }
+  }
+
+  Fault name(uint32_t var, uint16_t& index) {
+    auto it = name_index_.find(var);
+    if (it == name_index_.end()) {
+      if (out_.names_.size() > std::numeric_limits<uint16_t>::max()) {
+        return Fault::kTooManyVariables;
+      }
+      it = name_index_.emplace(var, static_cast<uint16_t>(out_.names_.size())).first;
+      out_.names_.push_back(MessageTable::instance().text(var));
+    }
+    index = it->second;
+    return Fault::kNone;
+  }
+
+  Bytecode& out_;
+  size_t instructions_{0};
+  std::unordered_map<uint32_t, uint16_t> name_index_;
+};
+
+Bytecode Bytecode::compile(const std::vector<Expr>& program) {
+  Bytecode bytecode;
+  Compiler compiler(bytecode);
+  for (const auto& expr : program) {
+    compiler.compile(expr);
+  }
+  fuse(bytecode.code_);
+  bytecode.code_.shrink_to_fit();
+  return bytecode;
+}
+
+bool verify(std::span<const Instruction> code, size_t name_count) {
+  auto operand = [&](const Operand& op, bool required) {
+    switch (op.kind) {
+      case Operand::kNone:
+        return !required;
+      case Operand::kConstant:
+        return true;
+      case Operand::kVariable:
+        return op.value < name_count;
+    }
+    return false;
+  };
+
+  std::array<size_t, Bytecode::kMaxLoopDepth> open{};
+  size_t depth = 0;
+  for (size_t i = 0; i < code.size(); ++i) {
+    const Instruction& in = code[i];
+    if (!operand(in.a, false) || !operand(in.b, false)) {
+      return false;
+    }
+    uint8_t flags = 0;
+    switch (first_half(in.op)) {
+      case OpCode::kNop:
+        break;
+      case OpCode::kDeclare:
+        if (in.dest >= name_count || !operand(in.b, true)) {
+          return false;
+        }
+        break;
+      case OpCode::kAdd:
+      case OpCode::kSub:
+        if (in.dest >= name_count || !operand(in.a, true) || !operand(in.b, true)) {
+          return false;
+        }
+        break;
+      case OpCode::kPrint:
+        flags = Instruction::kGreeting;
+        break;
+      case OpCode::kSleep:
+        if (!operand(in.b, true)) {
+          return false;
+        }
+        break;
+      case OpCode::kLoopBegin: {
+        flags = Instruction::kClosedForm;
+        if (depth == open.size() || !operand(in.b, true) || in.jump <= i ||
+            in.jump >= code.size() || code[in.jump].op != OpCode::kLoopEnd ||
+            code[in.jump].jump != i + 1) {
+          return false;
+        }
+        std::span<const Instruction> body = code.subspan(i + 1, in.jump - i - 1);
+        if ((in.flags & Instruction::kClosedForm) && (body.empty() || !closed_form(body))) {
+          return false;
+        }
+        open[depth++] = i;
+        break;
+      }
+      case OpCode::kLoopEnd:
+        if (depth == 0 || code[open[depth - 1]].jump != i) {
+          return false;
+        }
+        --depth;
+        break;
+      default:
+        return false;
+    }
+    if ((in.flags & ~flags) != 0) {
+      return false;
+    }
+    if (first_half(in.op) != in.op &&
+        (i + 1 == code.size() || fused(in, code[i + 1]) != in.op)) {
+      return false;
+    }
+  }
+  return depth == 0;
+}
+
+size_t Bytecode::memory_bytes() const {
+  size_t bytes = code_.capacity() * sizeof(Instruction) +
+                 names_.capacity() * sizeof(std::string);
+  for (const auto& name : names_) {
+    bytes += heap_bytes(name);
+  }
+  return bytes;
+}
+
+// Handlers are reached through a table of label addresses where the compiler
+// supports it, with a jump at the end of every handler so each has its own
+// branch history; a switch loop otherwise.
+#if defined(__GNUC__) && !defined(OSEMU_NO_THREADED_DISPATCH)
+#define OSEMU_THREADED_DISPATCH 1
+#endif
+
+StepResult run_bytecode(std::span<const Instruction> code, ExecutionContext& context,
+                        InstructionEvaluator& evaluator, size_t budget) {
+  StepResult result;
+  if (budget == 0) {
+    return result;
+  }
+  const Instruction* in = nullptr;
+
+  // Ticks still owed by a loop that was run in closed form.
+  auto charge_pending = [&]() {
+    uint64_t take = std::min<uint64_t>(context.pending, budget - result.leaves);
+    context.pending -= take;
+    result.leaves += take;
+  };
+  charge_pending();
+  if (result.leaves == budget) {
+    return result;
+  }
+
+  auto load = [&](const Operand& op) -> uint16_t {
+    return op.kind == Operand::kVariable ? evaluator.load_slot(op.value) : op.value;
+  };
+  auto declare = [&](const Instruction& i) {
+    evaluator.store_slot(i.dest, load(i.b));
+  };
+  auto add = [&](const Instruction& i) {
+    uint32_t sum = static_cast<uint32_t>(load(i.a)) + load(i.b);
+    evaluator.store_slot(i.dest, static_cast<uint16_t>(std::min<uint32_t>(sum, 65535)));
+  };
+  auto print = [&](const Instruction& i) {
+    LogRecord record;
+    if (i.flags & Instruction::kGreeting) {
+      record.flags = LogRecord::kGreeting;
+    } else {
+      record.prefix = i.prefix;
+      record.suffix = i.suffix;
+      if (i.a.kind != Operand::kNone) {
+        record.lead = load(i.a);
+        record.flags |= LogRecord::kLead;
+      }
+      if (i.b.kind != Operand::kNone) {
+        record.value = load(i.b);
+        record.flags |= LogRecord::kValue;
+      }
+    }
+    evaluator.print(record);
+  };
+
+#if OSEMU_THREADED_DISPATCH
+  // Same order as OpCode.
+  static const void* const kHandlers[] = {
+      &&op_nop,        &&op_declare,   &&op_add,        &&op_sub,
+      &&op_print,      &&op_sleep,     &&op_loop_begin, &&op_loop_end,
+      &&op_fault,      &&op_print_add, &&op_add_print,  &&op_declare_add,
+  };
+#define DISPATCH()                                      \
+  do {                                                  \
+    if (context.ip >= code.size()) return result;       \
+    in = &code[context.ip];                             \
+    goto *kHandlers[static_cast<uint8_t>(in->op)];      \
+  } while (0)
+#define HANDLER(label, op) label:
+#else
+#define DISPATCH() goto dispatch
+#define HANDLER(label, op) case OpCode::op:
+#endif
+
+// Every leaf handler ends here: count it and stop once the budget is spent.
+#define NEXT_LEAF()                    \
+  do {                                 \
+    ++context.ip;                      \
+    if (++result.leaves == budget) {   \
+      return result;                   \
+    }                                  \
+    DISPATCH();                        \
+  } while (0)
+
+// Between the halves of a superinstruction: count the first and, if the
+// budget allows, go straight on to the second.
+#define FUSED_NEXT()                   \
+  do {                                 \
+    ++context.ip;                      \
+    if (++result.leaves == budget) {   \
+      return result;                   \
+    }                                  \
+    in = &code[context.ip];            \
+  } while (0)
+
+#if OSEMU_THREADED_DISPATCH
+  DISPATCH();
+#else
+dispatch:
+  if (context.ip >= code.size()) {
+    return result;
+  }
+  in = &code[context.ip];
+  switch (in->op) {
+#endif
+
+  HANDLER(op_nop, kNop) {
+    NEXT_LEAF();
+  }
+
+  HANDLER(op_declare, kDeclare) {
+    declare(*in);
+    NEXT_LEAF();
+  }
+
+  HANDLER(op_add, kAdd) {
+    add(*in);
+    NEXT_LEAF();
+  }
+
+  HANDLER(op_sub, kSub) {
+    uint16_t lhs = load(in->a);
+    uint16_t rhs = load(in->b);
+    evaluator.store_slot(in->dest, lhs >= rhs ? lhs - rhs : 0);
+    NEXT_LEAF();
+  }
+
+  HANDLER(op_print, kPrint) {
+    print(*in);
+    NEXT_LEAF();
+  }
+
+  // The process goes to sleep after this, so the run ends here.
+  HANDLER(op_sleep, kSleep) {
+    result.sleep = load(in->b);
+    ++context.ip;
+    ++result.leaves;
+    return result;
+  }
+
+  HANDLER(op_loop_begin, kLoopBegin) {
+    uint16_t count = load(in->b);
+    if (in->b.kind == Operand::kVariable) {
+      result.leaf_delta += (static_cast<int64_t>(count) - 1) * in->body_cost;
+    }
+    if (count == 0) {
+      context.ip = in->jump + 1;
+    } else if (in->flags & Instruction::kClosedForm) {
+      run_closed_form(code.subspan(context.ip + 1, in->jump - context.ip - 1), count,
+                      evaluator);
+      context.ip = in->jump + 1;
+      context.pending = static_cast<uint64_t>(count) * in->body_cost;
+      charge_pending();
+      if (result.leaves == budget) {
+        return result;
+      }
+    } else {
+      context.remaining[context.depth++] = count;
+      ++context.ip;
+    }
+    DISPATCH();
+  }
+
+  HANDLER(op_loop_end, kLoopEnd) {
+    if (--context.remaining[context.depth - 1] > 0) {
+      context.ip = in->jump;
+    } else {
+      --context.depth;
+      ++context.ip;
+    }
+    DISPATCH();
+  }
+
+  // verify() rejects kFault, so verified code never gets here.
+  HANDLER(op_fault, kFault) {
+    result.fault = static_cast<Fault>(in->dest);
+    ++context.ip;
+    ++result.leaves;
+    return result;
+  }
+
+  HANDLER(op_print_add, kPrintAdd) {
+    print(*in);
+    FUSED_NEXT();
+    add(*in);
+    NEXT_LEAF();
+  }
+
+  HANDLER(op_add_print, kAddPrint) {
+    add(*in);
+    FUSED_NEXT();
+    print(*in);
+    NEXT_LEAF();
+  }
+
+  HANDLER(op_declare_add, kDeclareAdd) {
+    declare(*in);
+    FUSED_NEXT();
+    add(*in);
+    NEXT_LEAF();
+  }
+
+#if !OSEMU_THREADED_DISPATCH
+  }
+#endif
+  return result;
+
+#undef FUSED_NEXT
+#undef NEXT_LEAF
+#undef HANDLER
+#undef DISPATCH
+}
+
+}
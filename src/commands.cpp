@@ -13,6 +13,7 @@ const CommandMap cmd_map{
     {"scheduler-start", Commands::SchedulerStart},
     {"scheduler-stop", Commands::SchedulerStop},
     {"report-util", Commands::ReportUtil},
+    {"renice", Commands::Renice},
     {"clear", Commands::Clear},
     {"exit", Commands::Exit},
 
@@ -50,6 +50,25 @@ Config Config::fromFile(const std::filesystem::path& file) {
       cfg.maxInstructions = std::stoul(value);
     } else if (key == "delay-per-exec") {
       cfg.delayCyclesPerInstruction = std::stoul(value);
+    } else if (key == "ins-per-tick") {
+      cfg.instructionsPerTick = std::stoul(value);
+    } else if (key == "max-ready-queue") {
+      cfg.maxReadyQueue = std::stoul(value);
+    } else if (key == "max-live-processes") {
+      cfg.maxLiveProcesses = std::stoul(value);
+    } else if (key == "max-resident-ins") {
+      cfg.maxResidentInstructions = std::stoull(value);
+    } else if (key == "admission-policy") {
+      cfg.admissionPolicy = (value == "reject") ? AdmissionPolicy::Reject
+                                                : AdmissionPolicy::Defer;
+    } else if (key == "max-finished-records") {
+      cfg.maxFinishedRecords = std::stoul(value);
+    } else if (key == "archive-log-file") {
+      cfg.archiveLogFile = value;
+    } else if (key == "log-buffer-lines") {
+      cfg.logBufferLines = std::stoul(value);
+    } else if (key == "log-spill-file") {
+      cfg.logSpillFile = value;
     }
   }
   return cfg;
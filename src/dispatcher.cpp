@@ -5,6 +5,7 @@
 
 #include "config.hpp"
 #include "console.hpp"
+#include "process_control_block.hpp"
 #include "scheduler.hpp"
 #include "screen.hpp"
 
@@ -56,6 +57,24 @@ void dispatch(Commands cmd, std::vector<std::string>& args, Config& cfg,
       scheduler.generate_report();
       break;
 
+    case Commands::Renice:
+      if (args.size() != 2) {
+        std::cout << "Usage: renice <process name> <priority 0-"
+                  << static_cast<int>(PCB::kLowestPriority) << ">\n";
+      } else {
+        uint8_t priority = 0;
+        if (!PCB::parsePriority(args[1], priority)) {
+          std::cout << "Priority must be between 0 (highest) and "
+                    << static_cast<int>(PCB::kLowestPriority) << ".\n";
+        } else if (scheduler.renice(args[0], static_cast<uint8_t>(priority))) {
+          std::cout << "Process " << args[0] << " priority set to "
+                    << static_cast<int>(priority) << ".\n";
+        } else {
+          std::cout << "Process " << args[0] << " not found.\n";
+        }
+      }
+      break;
+
     case Commands::Clear:
       std::cout << "\x1b[2J\x1b[H";
       console_prompt();
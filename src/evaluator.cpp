@@ -17,12 +17,12 @@ void Evaluator::handle_print(const Atom& atom, const std::string& processName) {
     ss << "(" << std::put_time(&tm, "%m/%d/%Y %I:%M:%S%p") << ") ";
 
     if (atom.type == Atom::STRING) {
-        ss << "\"" << atom.string_value << "\"";
+        ss << "\"" << atom.text() << "\"";
     } else if (atom.type == Atom::NAME) {
-        if (variables_.count(atom.string_value)) {
-            ss << "\"" << variables_[atom.string_value] << "\"";
+        if (variables_.count(atom.text())) {
+            ss << "\"" << variables_[atom.text()] << "\"";
         } else {
-            ss << "Variable " << atom.string_value << " not found";
+            ss << "Variable " << atom.text() << " not found";
         }
     }
     output_log_.push_back(ss.str());
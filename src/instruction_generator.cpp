@@ -3,6 +3,14 @@
 
 namespace osemu {
 
+namespace {
+
+uint32_t intern(std::string_view text) {
+    return MessageTable::instance().intern(text);
+}
+
+}
+
 InstructionGenerator::InstructionGenerator() 
     : rng(std::random_device{}()),
       instruction_type_dist(0, 5), 
@@ -22,15 +30,13 @@ std::string InstructionGenerator::generateVariableName() {
 Expr InstructionGenerator::generatePrintInstruction(const std::string& process_name) {
     
     std::string message = "Hello world from " + process_name + "!";
-    auto atom = std::make_unique<Atom>(message, Atom::STRING);
-    return Expr::make_call("PRINT", std::move(atom));
+    return Expr::make_call(intern("PRINT"), Atom(message, Atom::STRING));
 }
 
 Expr InstructionGenerator::generateDeclareInstruction() {
     std::string var_name = generateVariableName();
     uint16_t value = value_dist(rng);
-    auto atom = std::make_unique<Atom>(value);
-    return Expr::make_declare(var_name, std::move(atom));
+    return Expr::make_declare(intern(var_name), Atom(value));
 }
 
 Expr InstructionGenerator::generateAddInstruction() {
@@ -38,10 +44,7 @@ Expr InstructionGenerator::generateAddInstruction() {
     std::string operand1 = generateVariableName();
     uint16_t operand2_val = value_dist(rng);
     
-    auto lhs = std::make_unique<Atom>(operand1, Atom::NAME);
-    auto rhs = std::make_unique<Atom>(operand2_val);
-    
-    return Expr::make_add(result_var, std::move(lhs), std::move(rhs));
+    return Expr::make_add(intern(result_var), Atom(operand1, Atom::NAME), Atom(operand2_val));
 }
 
 Expr InstructionGenerator::generateSubtractInstruction() {
@@ -49,17 +52,13 @@ Expr InstructionGenerator::generateSubtractInstruction() {
     std::string operand1 = generateVariableName();
     uint16_t operand2_val = value_dist(rng);
     
-    auto lhs = std::make_unique<Atom>(operand1, Atom::NAME);
-    auto rhs = std::make_unique<Atom>(operand2_val);
-    
-    return Expr::make_sub(result_var, std::move(lhs), std::move(rhs));
+    return Expr::make_sub(intern(result_var), Atom(operand1, Atom::NAME), Atom(operand2_val));
 }
 
 Expr InstructionGenerator::generateSleepInstruction() {
     std::uniform_int_distribution<uint16_t> sleep_dist(1, 10); 
     uint16_t sleep_cycles = sleep_dist(rng);
-    auto atom = std::make_unique<Atom>(sleep_cycles);
-    return Expr::make_call("SLEEP", std::move(atom));
+    return Expr::make_call(intern("SLEEP"), Atom(sleep_cycles));
 }
 
 Expr InstructionGenerator::generateForInstruction(int max_depth) {
@@ -90,36 +89,41 @@ Expr InstructionGenerator::generateForInstruction(int max_depth) {
     }
     
     uint16_t loop_count = for_count_dist(rng);
-    auto count_atom = std::make_unique<Atom>(loop_count);
-    
-    return Expr::make_for(std::move(body), std::move(count_atom));
+    return Expr::make_for(std::move(body), Atom(loop_count));
 }
 
-std::vector<Expr> InstructionGenerator::generateInstructions(size_t count, const std::string& process_name) {
+std::vector<Expr> InstructionGenerator::generateInstructions(size_t count) {
     std::vector<Expr> instructions;
     instructions.reserve(count);
     
+    const uint32_t print = intern("PRINT");
+    const Atom message("Value from: ", Atom::STRING);
+    const Atom x("x", Atom::NAME);
     for (size_t i = 0; i < count; i++) {
         if (i % 2 == 0) {
-            auto lhs = std::make_unique<Atom>("Value from: ", Atom::STRING);
-            auto rhs = std::make_unique<Atom>("x", Atom::NAME);
-            instructions.push_back(Expr::make_call_concat("PRINT", std::move(lhs), std::move(rhs)));
+            instructions.push_back(Expr::make_call_concat(print, message, x));
         } else {
             uint16_t add_val = add_value_dist(rng);
-            auto lhs = std::make_unique<Atom>("x", Atom::NAME);
-            auto rhs = std::make_unique<Atom>(add_val);
-            instructions.push_back(Expr::make_add("x", std::move(lhs), std::move(rhs)));
+            instructions.push_back(Expr::make_add(x.string_id, x, Atom(add_val)));
         }
     }
     
     return instructions;
 }
 
-std::vector<Expr> InstructionGenerator::generateRandomProgram(size_t min_instructions, size_t max_instructions, const std::string& process_name) {
+std::vector<Expr> InstructionGenerator::generateRandomProgram(size_t min_instructions, size_t max_instructions) {
+    std::uniform_int_distribution<size_t> count_dist(min_instructions, max_instructions);
+    size_t instruction_count = count_dist(rng);
+    
+    return generateInstructions(instruction_count);
+}
+
+ProgramImagePtr InstructionGenerator::generateLazyProgram(size_t min_instructions, size_t max_instructions) {
     std::uniform_int_distribution<size_t> count_dist(min_instructions, max_instructions);
     size_t instruction_count = count_dist(rng);
+    uint64_t seed = (static_cast<uint64_t>(rng()) << 32) | rng();
     
-    return generateInstructions(instruction_count, process_name);
+    return std::make_shared<const ProgramImage>(seed, instruction_count);
 }
 
 }  
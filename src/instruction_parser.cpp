@@ -1,10 +1,9 @@
 #include "instruction_parser.hpp"
 #include <cctype>
 #include <algorithm>
-#include <stdexcept>
+#include <charconv>
+#include <limits>
 #include <sstream>
-#include <chrono>
-#include <format>
 
 namespace osemu {
 
@@ -77,18 +76,15 @@ ParseResult InstructionParser::parse_number(const std::string& input, Atom& resu
         i++;
     }
     
-    std::string number_str = trimmed.substr(0, i);
-    try {
-        unsigned long number_val = std::stoul(number_str);
-        if (number_val > 65535) {
-            return ParseResult(false, trimmed, "Number out of range for uint16_t");
-        }
-        result = Atom(static_cast<uint16_t>(number_val));
-    } catch (const std::invalid_argument&) {
-        return ParseResult(false, trimmed, "Invalid number format");
-    } catch (const std::out_of_range&) {
+    uint16_t number_val = 0;
+    auto [end, ec] = std::from_chars(trimmed.data(), trimmed.data() + i, number_val);
+    if (ec == std::errc::result_out_of_range) {
         return ParseResult(false, trimmed, "Number out of range for uint16_t");
     }
+    if (ec != std::errc() || end != trimmed.data() + i) {
+        return ParseResult(false, trimmed, "Invalid number format");
+    }
+    result = Atom(number_val);
     
     return ParseResult(true, trimmed.substr(i));
 }
@@ -125,7 +121,7 @@ ParseResult InstructionParser::parse_declare(const std::string& input, Expr& res
         return ParseResult(false, remaining, "Expected opening parenthesis");
     }
     
-    Atom name_atom(0);
+    Atom name_atom;
     ParseResult name_result = parse_name(remaining, name_atom);
     if (!name_result.success) {
         return ParseResult(false, remaining, "Expected variable name");
@@ -137,7 +133,7 @@ ParseResult InstructionParser::parse_declare(const std::string& input, Expr& res
         return ParseResult(false, remaining, "Expected comma");
     }
     
-    Atom value_atom(0);
+    Atom value_atom;
     ParseResult value_result = parse_atom(remaining, value_atom);
     if (!value_result.success) {
         return ParseResult(false, remaining, "Expected value");
@@ -149,8 +145,8 @@ ParseResult InstructionParser::parse_declare(const std::string& input, Expr& res
         return ParseResult(false, remaining, "Expected closing parenthesis");
     }
     
-    result = Expr::make_declare(name_atom.string_value, 
-                               std::make_unique<Atom>(value_atom));
+    result = Expr::make_declare(name_atom.string_id, 
+                               value_atom);
     
     return ParseResult(true, remaining);
 }
@@ -166,7 +162,7 @@ ParseResult InstructionParser::parse_add(const std::string& input, Expr& result)
         return ParseResult(false, remaining, "Expected opening parenthesis");
     }
     
-    Atom var_atom(0);
+    Atom var_atom;
     ParseResult var_result = parse_name(remaining, var_atom);
     if (!var_result.success) {
         return ParseResult(false, remaining, "Expected variable name");
@@ -178,7 +174,7 @@ ParseResult InstructionParser::parse_add(const std::string& input, Expr& result)
         return ParseResult(false, remaining, "Expected comma");
     }
     
-    Atom lhs_atom(0);
+    Atom lhs_atom;
     ParseResult lhs_result = parse_atom(remaining, lhs_atom);
     if (!lhs_result.success) {
         return ParseResult(false, remaining, "Expected left operand");
@@ -190,7 +186,7 @@ ParseResult InstructionParser::parse_add(const std::string& input, Expr& result)
         return ParseResult(false, remaining, "Expected comma");
     }
     
-    Atom rhs_atom(0);
+    Atom rhs_atom;
     ParseResult rhs_result = parse_atom(remaining, rhs_atom);
     if (!rhs_result.success) {
         return ParseResult(false, remaining, "Expected right operand");
@@ -202,9 +198,9 @@ ParseResult InstructionParser::parse_add(const std::string& input, Expr& result)
         return ParseResult(false, remaining, "Expected closing parenthesis");
     }
     
-    result = Expr::make_add(var_atom.string_value,
-                           std::make_unique<Atom>(lhs_atom),
-                           std::make_unique<Atom>(rhs_atom));
+    result = Expr::make_add(var_atom.string_id,
+                           lhs_atom,
+                           rhs_atom);
     
     return ParseResult(true, remaining);
 }
@@ -220,7 +216,7 @@ ParseResult InstructionParser::parse_sub(const std::string& input, Expr& result)
         return ParseResult(false, remaining, "Expected opening parenthesis");
     }
     
-    Atom var_atom(0);
+    Atom var_atom;
     ParseResult var_result = parse_name(remaining, var_atom);
     if (!var_result.success) {
         return ParseResult(false, remaining, "Expected variable name");
@@ -232,7 +228,7 @@ ParseResult InstructionParser::parse_sub(const std::string& input, Expr& result)
         return ParseResult(false, remaining, "Expected comma");
     }
     
-    Atom lhs_atom(0);
+    Atom lhs_atom;
     ParseResult lhs_result = parse_atom(remaining, lhs_atom);
     if (!lhs_result.success) {
         return ParseResult(false, remaining, "Expected left operand");
@@ -244,7 +240,7 @@ ParseResult InstructionParser::parse_sub(const std::string& input, Expr& result)
         return ParseResult(false, remaining, "Expected comma");
     }
     
-    Atom rhs_atom(0);
+    Atom rhs_atom;
     ParseResult rhs_result = parse_atom(remaining, rhs_atom);
     if (!rhs_result.success) {
         return ParseResult(false, remaining, "Expected right operand");
@@ -256,9 +252,9 @@ ParseResult InstructionParser::parse_sub(const std::string& input, Expr& result)
         return ParseResult(false, remaining, "Expected closing parenthesis");
     }
     
-    result = Expr::make_sub(var_atom.string_value,
-                           std::make_unique<Atom>(lhs_atom),
-                           std::make_unique<Atom>(rhs_atom));
+    result = Expr::make_sub(var_atom.string_id,
+                           lhs_atom,
+                           rhs_atom);
     
     return ParseResult(true, remaining);
 }
@@ -266,7 +262,7 @@ ParseResult InstructionParser::parse_sub(const std::string& input, Expr& result)
 ParseResult InstructionParser::parse_call(const std::string& input, Expr& result) {
     std::string trimmed = ltrim(input);
     
-    Atom name_atom(0);
+    Atom name_atom;
     ParseResult name_result = parse_name(trimmed, name_atom);
     if (!name_result.success) {
         return ParseResult(false, trimmed, "Expected function name");
@@ -279,14 +275,14 @@ ParseResult InstructionParser::parse_call(const std::string& input, Expr& result
     }
     
     
-    Atom lhs_atom(0);
+    Atom lhs_atom;
     ParseResult lhs_res = parse_atom(remaining, lhs_atom);
     if (lhs_res.success) {
         std::string temp_remaining = ltrim(lhs_res.remaining);
         if (!temp_remaining.empty() && temp_remaining[0] == '+') {
             consume_tag(temp_remaining, "+", temp_remaining); 
             
-            Atom rhs_atom(0);
+            Atom rhs_atom;
             ParseResult rhs_res = parse_atom(ltrim(temp_remaining), rhs_atom);
             if (!rhs_res.success) {
                 return ParseResult(false, temp_remaining, "Expected right-hand side for concatenation");
@@ -297,15 +293,15 @@ ParseResult InstructionParser::parse_call(const std::string& input, Expr& result
                 return ParseResult(false, remaining, "Expected closing parenthesis after concatenation");
             }
             
-            result = Expr::make_call_concat(name_atom.string_value, 
-                                            std::make_unique<Atom>(lhs_atom),
-                                            std::make_unique<Atom>(rhs_atom));
+            result = Expr::make_call_concat(name_atom.string_id, 
+                                            lhs_atom,
+                                            rhs_atom);
             return ParseResult(true, remaining);
         }
     }
 
     
-    Atom arg_atom(0);
+    Atom arg_atom;
     ParseResult arg_result = parse_atom(remaining, arg_atom);
     if (!arg_result.success) {
         return ParseResult(false, remaining, "Expected argument");
@@ -317,8 +313,8 @@ ParseResult InstructionParser::parse_call(const std::string& input, Expr& result
         return ParseResult(false, remaining, "Expected closing parenthesis");
     }
     
-    result = Expr::make_call(name_atom.string_value,
-                            std::make_unique<Atom>(arg_atom));
+    result = Expr::make_call(name_atom.string_id,
+                            arg_atom);
     
     return ParseResult(true, remaining);
 }
@@ -366,7 +362,7 @@ ParseResult InstructionParser::parse_for(const std::string& input, Expr& result)
         return ParseResult(false, remaining, "Expected comma");
     }
     
-    Atom n_atom(0);
+    Atom n_atom;
     ParseResult n_result = parse_atom(remaining, n_atom);
     if (!n_result.success) {
         return ParseResult(false, remaining, "Expected loop count");
@@ -378,7 +374,7 @@ ParseResult InstructionParser::parse_for(const std::string& input, Expr& result)
         return ParseResult(false, remaining, "Expected closing parenthesis");
     }
     
-    result = Expr::make_for(std::move(body), std::make_unique<Atom>(n_atom));
+    result = Expr::make_for(std::move(body), n_atom);
     
     return ParseResult(true, remaining);
 }
@@ -439,175 +435,284 @@ ParseResult InstructionParser::parse_program(const std::string& input, std::vect
 
 
 
+const char* to_string(Fault fault) {
+    switch (fault) {
+        case Fault::kNone:
+            return "none";
+        case Fault::kMissingOperand:
+            return "missing operand";
+        case Fault::kNotNumeric:
+            return "string used as a number";
+        case Fault::kUnknownFunction:
+            return "unknown function";
+        case Fault::kUnknownInstruction:
+            return "unknown instruction";
+        case Fault::kLoopTooDeep:
+            return "FOR nested too deeply";
+        case Fault::kTooManyVariables:
+            return "too many variables";
+        case Fault::kUnverifiedProgram:
+            return "program failed verification";
+    }
+    return "unknown fault";
+}
+
 InstructionEvaluator::InstructionEvaluator() {
     
 }
 
-void InstructionEvaluator::evaluate(const Expr& expr) {
+void InstructionEvaluator::bind_symbols(const std::vector<std::string>& symbols) {
+    symbols_ = &symbols;
+    extra_names_.clear();
+    slots_.assign(symbols.size(), 0);
+    update_variable_bytes();
+}
+
+void InstructionEvaluator::update_variable_bytes() {
+    size_t bytes = slots_.capacity() * sizeof(uint16_t) +
+                   extra_names_.capacity() * sizeof(std::string);
+    for (const auto& name : extra_names_) {
+        bytes += heap_bytes(name);
+    }
+    variable_bytes_.store(bytes, std::memory_order_relaxed);
+}
+
+int InstructionEvaluator::slot_of(const std::string& name) const {
+    if (!symbols_) {
+        return -1;
+    }
+    // Programs have a handful of names; the bytecode never comes through here.
+    for (size_t i = 0; i < symbols_->size(); ++i) {
+        if ((*symbols_)[i] == name) {
+            return static_cast<int>(i);
+        }
+    }
+    for (size_t i = 0; i < extra_names_.size(); ++i) {
+        if (extra_names_[i] == name) {
+            return static_cast<int>(symbols_->size() + i);
+        }
+    }
+    return -1;
+}
+
+uint16_t InstructionEvaluator::load_variable(const std::string& name) const {
+    int slot = slot_of(name);
+    return slot >= 0 ? slots_[slot] : 0;
+}
+
+Fault InstructionEvaluator::store_variable(const std::string& name, uint16_t value) {
+    int slot = slot_of(name);
+    if (slot >= 0) {
+        slots_[slot] = value;
+        return Fault::kNone;
+    }
+    if (slots_.size() > std::numeric_limits<uint16_t>::max()) {
+        return Fault::kTooManyVariables;
+    }
+    extra_names_.push_back(name);
+    slots_.push_back(value);
+    update_variable_bytes();
+    return Fault::kNone;
+}
+
+Fault InstructionEvaluator::evaluate(const Expr& expr) {
     switch (expr.type) {
-        case Expr::DECLARE: {
-            if (expr.var_name.empty() || !expr.atom_value) {
-                throw std::runtime_error("Invalid DECLARE: missing variable name or value");
+        case Expr::DECLARE:
+            if (expr.name == 0 || !expr.lhs) {
+                return Fault::kMissingOperand;
             }
-            handle_declare(expr.var_name, *expr.atom_value);
-            break;
-        }
+            return handle_declare(expr.name_text(), expr.lhs);
         
         case Expr::CALL: {
-            if (expr.var_name == "PRINT") {
-                if (expr.atom_value) { 
-                    handle_print(*expr.atom_value, "");
-                } else if (expr.lhs && expr.rhs) { 
-                    std::string lhs_str = print_atom_to_string(*expr.lhs);
-                    std::string rhs_str = print_atom_to_string(*expr.rhs);
-                    Atom concatenated_atom(lhs_str + rhs_str, Atom::STRING);
-                    handle_print(concatenated_atom, "");
-                } else {
-                    throw std::runtime_error("Invalid PRINT call: malformed arguments");
+            const std::string& function = expr.name_text();
+            if (function == "PRINT") {
+                if (expr.lhs && expr.rhs) { 
+                    return handle_print_concat(expr.lhs, expr.rhs);
                 }
-            } else if (expr.var_name == "SLEEP") {
-                if (!expr.atom_value) {
-                    throw std::runtime_error("Invalid SLEEP call: missing argument");
+                if (expr.lhs) { 
+                    return handle_print(expr.lhs);
                 }
-                handle_sleep(*expr.atom_value);
-            } else {
-                throw std::runtime_error("Unknown function: " + expr.var_name);
+                return Fault::kMissingOperand;
             }
-            break;
+            if (function == "SLEEP") {
+                if (!expr.lhs) {
+                    return Fault::kMissingOperand;
+                }
+                return handle_sleep(expr.lhs);
+            }
+            return Fault::kUnknownFunction;
         }
         
-        case Expr::ADD: {
-            if (expr.var_name.empty() || !expr.lhs || !expr.rhs) {
-                throw std::runtime_error("Invalid ADD: missing variable name or operands");
+        case Expr::ADD:
+            if (expr.name == 0 || !expr.lhs || !expr.rhs) {
+                return Fault::kMissingOperand;
             }
-            handle_add(expr.var_name, *expr.lhs, *expr.rhs);
-            break;
-        }
+            return handle_add(expr.name_text(), expr.lhs, expr.rhs);
         
-        case Expr::SUB: {
-            if (expr.var_name.empty() || !expr.lhs || !expr.rhs) {
-                throw std::runtime_error("Invalid SUB: missing variable name or operands");
+        case Expr::SUB:
+            if (expr.name == 0 || !expr.lhs || !expr.rhs) {
+                return Fault::kMissingOperand;
             }
-            handle_sub(expr.var_name, *expr.lhs, *expr.rhs);
-            break;
-        }
+            return handle_sub(expr.name_text(), expr.lhs, expr.rhs);
         
-        case Expr::FOR: {
-            if (!expr.n) {
-                throw std::runtime_error("Invalid FOR: missing loop count");
+        case Expr::FOR:
+            if (!expr.lhs) {
+                return Fault::kMissingOperand;
             }
-            handle_for(expr.body, *expr.n);
-            break;
-        }
+            return handle_for(expr.body, expr.lhs);
         
         case Expr::CONSTANT:
         case Expr::VOID_EXPR:
-            
-            break;
-            
-        default:
-            throw std::runtime_error("Unknown expression type");
+            return Fault::kNone;
     }
+    return Fault::kUnknownInstruction;
 }
 
-void InstructionEvaluator::evaluate_program(const std::vector<Expr>& program) {
+Fault InstructionEvaluator::evaluate_program(const std::vector<Expr>& program) {
+    Fault first = Fault::kNone;
     for (const auto& expr : program) {
-        evaluate(expr);
+        Fault fault = evaluate(expr);
+        if (first == Fault::kNone) {
+            first = fault;
+        }
     }
+    return first;
 }
 
-uint16_t InstructionEvaluator::resolve_atom_value(const Atom& atom) {
+Fault InstructionEvaluator::resolve_atom_value(const Atom& atom, uint16_t& value) const {
     switch (atom.type) {
-        case Atom::NAME: {
-            auto it = variables.find(atom.string_value);
-            if (it != variables.end()) {
-                return it->second;
-            } else {
-                
-                return 0;
-            }
-        }
+        case Atom::NAME:
+            value = load_variable(atom.text());
+            return Fault::kNone;
         case Atom::NUMBER:
-            return atom.number_value;
+            value = atom.number_value;
+            return Fault::kNone;
         case Atom::STRING:
-            throw std::runtime_error("Cannot convert string to numeric value");
+            return Fault::kNotNumeric;
         default:
-            throw std::runtime_error("Unknown atom type");
+            return Fault::kMissingOperand;
     }
 }
 
 std::string InstructionEvaluator::print_atom_to_string(const Atom& atom) {
     switch (atom.type) {
         case Atom::STRING:
-            return atom.string_value;
+            return atom.text();
         case Atom::NUMBER:
             return std::to_string(atom.number_value);
-        case Atom::NAME: {
-            
-            auto it = variables.find(atom.string_value);
-            if (it != variables.end()) {
-                return std::to_string(it->second);
-            } else {
-                return "0"; 
-            }
-        }
+        case Atom::NAME:
+            return std::to_string(load_variable(atom.text()));
         default:
-            throw std::runtime_error("Unknown atom type in print");
+            return {};
     }
 }
 
-void InstructionEvaluator::handle_declare(const std::string& var_name, const Atom& value) {
-    if (value.type == Atom::NUMBER) {
-        variables[var_name] = value.number_value;
-    } else if (value.type == Atom::NAME) {
-        
-        variables[var_name] = resolve_atom_value(value);
-    } else {
-        throw std::runtime_error("DECLARE requires numeric value or variable reference");
+Fault InstructionEvaluator::handle_declare(const std::string& var_name, const Atom& value) {
+    uint16_t number = 0;
+    Fault fault = resolve_atom_value(value, number);
+    if (fault == Fault::kNone) {
+        fault = store_variable(var_name, number);
     }
+    return fault;
 }
 
-std::string InstructionEvaluator::handle_print(const Atom& arg, const std::string& process_name) {
-    std::string output = print_atom_to_string(arg);
-    
-    auto now = std::chrono::system_clock::now();
-    auto truncated_time = std::chrono::time_point_cast<std::chrono::seconds>(now);
-    std::string timestamp = std::format("{:%m/%d/%Y %I:%M:%S %p}", truncated_time);
+LogRecord InstructionEvaluator::new_log_record() const {
+    LogRecord record;
+    record.tick = log_tick_;
+    record.time = TimestampCache::instance().now();
+    record.core = log_core_;
+    return record;
+}
 
-    std::string log_entry;
-    if (!process_name.empty()) {
-        log_entry = std::format("({}) \"{}\"", timestamp, output);
+// PRINT only records what to say; the text is put together when the log is
+// viewed.
+Fault InstructionEvaluator::handle_print(const Atom& arg) {
+    LogRecord record = new_log_record();
+    if (arg.type == Atom::STRING) {
+        record.prefix = arg.string_id;
     } else {
-        log_entry = std::format("({}) \"{}\"", timestamp, output);
+        if (Fault fault = resolve_atom_value(arg, record.value); fault != Fault::kNone) {
+            return fault;
+        }
+        record.flags |= LogRecord::kValue;
     }
-    
-    output_log.push_back(log_entry);
-    return output;
+    output_log.append(record);
+    return Fault::kNone;
 }
 
-void InstructionEvaluator::handle_sleep(const Atom& duration) {
-    uint16_t cycles = resolve_atom_value(duration);
-    
-    
+Fault InstructionEvaluator::handle_print_concat(const Atom& lhs, const Atom& rhs) {
+    LogRecord record = new_log_record();
+    Fault fault = Fault::kNone;
+    if (lhs.type == Atom::STRING) {
+        record.prefix = lhs.string_id;
+        if (rhs.type == Atom::STRING) {
+            record.suffix = rhs.string_id;
+        } else {
+            fault = resolve_atom_value(rhs, record.value);
+            record.flags |= LogRecord::kValue;
+        }
+    } else if (rhs.type == Atom::STRING) {
+        fault = resolve_atom_value(lhs, record.value);
+        record.flags |= LogRecord::kValue;
+        record.suffix = rhs.string_id;
+    } else {
+        fault = resolve_atom_value(lhs, record.lead);
+        if (fault == Fault::kNone) {
+            fault = resolve_atom_value(rhs, record.value);
+        }
+        record.flags |= LogRecord::kLead | LogRecord::kValue;
+    }
+    if (fault == Fault::kNone) {
+        output_log.append(record);
+    }
+    return fault;
 }
 
-void InstructionEvaluator::handle_add(const std::string& var, const Atom& lhs, const Atom& rhs) {
-    uint16_t left_val = resolve_atom_value(lhs);
-    uint16_t right_val = resolve_atom_value(rhs);
-    
+void InstructionEvaluator::print(const LogRecord& record) {
+    LogRecord stamped = new_log_record();
+    stamped.prefix = record.prefix;
+    stamped.suffix = record.suffix;
+    stamped.value = record.value;
+    stamped.lead = record.lead;
+    stamped.flags = record.flags;
+    output_log.append(stamped);
+}
+
+// The tree walker has no notion of ticks; SLEEP only checks its operand.
+Fault InstructionEvaluator::handle_sleep(const Atom& duration) {
+    uint16_t cycles = 0;
+    return resolve_atom_value(duration, cycles);
+}
+
+Fault InstructionEvaluator::handle_add(const std::string& var, const Atom& lhs, const Atom& rhs) {
+    uint16_t left_val = 0;
+    uint16_t right_val = 0;
+    Fault fault = resolve_atom_value(lhs, left_val);
+    if (fault == Fault::kNone) {
+        fault = resolve_atom_value(rhs, right_val);
+    }
+    if (fault != Fault::kNone) {
+        return fault;
+    }
     
     uint32_t result = static_cast<uint32_t>(left_val) + static_cast<uint32_t>(right_val);
     if (result > 65535) {
         result = 65535; 
     }
     
-    variables[var] = static_cast<uint16_t>(result);
+    return store_variable(var, static_cast<uint16_t>(result));
 }
 
-void InstructionEvaluator::handle_sub(const std::string& var, const Atom& lhs, const Atom& rhs) {
-    uint16_t left_val = resolve_atom_value(lhs);
-    uint16_t right_val = resolve_atom_value(rhs);
-    
+Fault InstructionEvaluator::handle_sub(const std::string& var, const Atom& lhs, const Atom& rhs) {
+    uint16_t left_val = 0;
+    uint16_t right_val = 0;
+    Fault fault = resolve_atom_value(lhs, left_val);
+    if (fault == Fault::kNone) {
+        fault = resolve_atom_value(rhs, right_val);
+    }
+    if (fault != Fault::kNone) {
+        return fault;
+    }
     
     uint16_t result;
     if (left_val >= right_val) {
@@ -616,20 +721,25 @@ void InstructionEvaluator::handle_sub(const std::string& var, const Atom& lhs, c
         result = 0; 
     }
     
-    variables[var] = result;
+    return store_variable(var, result);
 }
 
-void InstructionEvaluator::handle_for(const std::vector<Expr>& body, const Atom& count) {
-    uint16_t iterations = resolve_atom_value(count);
+Fault InstructionEvaluator::handle_for(const std::vector<Expr>& body, const Atom& count) {
+    uint16_t iterations = 0;
+    Fault first = resolve_atom_value(count, iterations);
     
     for (uint16_t i = 0; i < iterations; i++) {
         for (const auto& instruction : body) {
-            evaluate(instruction);
+            Fault fault = evaluate(instruction);
+            if (first == Fault::kNone) {
+                first = fault;
+            }
         }
     }
+    return first;
 }
 
 void InstructionEvaluator::clear_variables() {
-    variables.clear();
+    std::fill(slots_.begin(), slots_.end(), 0);
 }
 }  
@@ -0,0 +1,258 @@
+#include "lockstep.hpp"
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace osemu {
+
+namespace {
+
+// One variable across every lane.
+using Row = std::array<uint16_t, kLockstepLanes>;
+
+void add_rows(uint16_t* dest, const uint16_t* a, const uint16_t* b) {
+#if defined(__AVX2__)
+  __m256i sum = _mm256_adds_epu16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a)),
+                                  _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b)));
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest), sum);
+#elif defined(__SSE2__) || defined(_M_X64)
+  for (size_t i = 0; i < kLockstepLanes; i += 8) {
+    __m128i sum = _mm_adds_epu16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+                                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), sum);
+  }
+#else
+  for (size_t i = 0; i < kLockstepLanes; ++i) {
+    uint32_t sum = static_cast<uint32_t>(a[i]) + b[i];
+    dest[i] = static_cast<uint16_t>(std::min<uint32_t>(sum, 65535));
+  }
+#endif
+}
+
+void sub_rows(uint16_t* dest, const uint16_t* a, const uint16_t* b) {
+#if defined(__AVX2__)
+  __m256i diff = _mm256_subs_epu16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a)),
+                                   _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b)));
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest), diff);
+#elif defined(__SSE2__) || defined(_M_X64)
+  for (size_t i = 0; i < kLockstepLanes; i += 8) {
+    __m128i diff = _mm_subs_epu16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+                                  _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), diff);
+  }
+#else
+  for (size_t i = 0; i < kLockstepLanes; ++i) {
+    dest[i] = a[i] >= b[i] ? a[i] - b[i] : 0;
+  }
+#endif
+}
+
+class Lanes {
+ public:
+  Lanes(std::span<const LockstepLane> lanes, size_t slots)
+      : lanes_(lanes), rows_(slots) {
+    for (size_t slot = 0; slot < slots; ++slot) {
+      for (size_t lane = 0; lane < lanes_.size(); ++lane) {
+        rows_[slot][lane] = lanes_[lane].evaluator->load_slot(static_cast<uint16_t>(slot));
+      }
+    }
+  }
+
+  void store() const {
+    for (size_t slot = 0; slot < rows_.size(); ++slot) {
+      for (size_t lane = 0; lane < lanes_.size(); ++lane) {
+        lanes_[lane].evaluator->store_slot(static_cast<uint16_t>(slot), rows_[slot][lane]);
+      }
+    }
+  }
+
+  const uint16_t* operand(const Operand& op, Row& scratch) const {
+    if (op.kind == Operand::kVariable) {
+      return rows_[op.value].data();
+    }
+    scratch.fill(op.value);
+    return scratch.data();
+  }
+
+  // The operand's value if every lane has the same one.
+  bool uniform(const Operand& op, uint16_t& value) const {
+    if (op.kind != Operand::kVariable) {
+      value = op.value;
+      return true;
+    }
+    const Row& row = rows_[op.value];
+    value = row[0];
+    return std::all_of(row.begin(), row.begin() + lanes_.size(),
+                       [&](uint16_t v) { return v == value; });
+  }
+
+  void execute(const Instruction& in) {
+    Row a_scratch;
+    Row b_scratch;
+    switch (first_half(in.op)) {
+      case OpCode::kDeclare: {
+        const uint16_t* b = operand(in.b, b_scratch);
+        std::copy(b, b + kLockstepLanes, rows_[in.dest].begin());
+        break;
+      }
+      case OpCode::kAdd:
+        add_rows(rows_[in.dest].data(), operand(in.a, a_scratch), operand(in.b, b_scratch));
+        break;
+      case OpCode::kSub:
+        sub_rows(rows_[in.dest].data(), operand(in.a, a_scratch), operand(in.b, b_scratch));
+        break;
+      case OpCode::kPrint:
+        print(in);
+        break;
+      default:
+        break;
+    }
+  }
+
+ private:
+  void print(const Instruction& in) {
+    Row a_scratch;
+    Row b_scratch;
+    const uint16_t* a = in.a.kind != Operand::kNone ? operand(in.a, a_scratch) : nullptr;
+    const uint16_t* b = in.b.kind != Operand::kNone ? operand(in.b, b_scratch) : nullptr;
+    LogRecord record;
+    if (in.flags & Instruction::kGreeting) {
+      record.flags = LogRecord::kGreeting;
+    } else {
+      record.prefix = in.prefix;
+      record.suffix = in.suffix;
+      record.flags = (a ? LogRecord::kLead : 0) | (b ? LogRecord::kValue : 0);
+    }
+    for (size_t i = 0; i < lanes_.size(); ++i) {
+      record.lead = a ? a[i] : 0;
+      record.value = b ? b[i] : 0;
+      lanes_[i].evaluator->print(record);
+    }
+  }
+
+  std::span<const LockstepLane> lanes_;
+  std::vector<Row> rows_;
+};
+
+}
+
+StepResult run_lockstep(const ProgramImage& program, ExecutionContext& context,
+                        std::span<const LockstepLane> lanes, size_t budget,
+                        uint64_t tick, int core) {
+  StepResult total;
+  if (lanes.empty() || lanes.size() > kLockstepLanes || !program.is_verified()) {
+    return total;
+  }
+  for (const LockstepLane& lane : lanes) {
+    lane.evaluator->set_log_context(tick, core);
+  }
+  Lanes rows(lanes, program.names().size());
+  CodeScratch scratch;
+  size_t segments = program.segment_count();
+
+  auto charge_pending = [&]() {
+    uint64_t take = std::min<uint64_t>(context.pending, budget - total.leaves);
+    context.pending -= take;
+    total.leaves += take;
+  };
+
+  bool stopped = false;
+  while (!stopped && total.leaves < budget && context.pc < segments) {
+    std::span<const Instruction> code = program.segment(context.pc, scratch);
+    charge_pending();
+    while (total.leaves < budget && context.ip < code.size()) {
+      const Instruction& in = code[context.ip];
+      uint16_t value = 0;
+      if (in.op == OpCode::kLoopBegin) {
+        if (!rows.uniform(in.b, value)) {
+          stopped = true;
+          break;
+        }
+        if (in.b.kind == Operand::kVariable) {
+          total.leaf_delta += (static_cast<int64_t>(value) - 1) * in.body_cost;
+        }
+        // Closed-form loops run pass by pass here; every lane pays the same.
+        if (value == 0) {
+          context.ip = in.jump + 1;
+        } else {
+          context.remaining[context.depth++] = value;
+          ++context.ip;
+        }
+        continue;
+      }
+      if (in.op == OpCode::kLoopEnd) {
+        if (--context.remaining[context.depth - 1] > 0) {
+          context.ip = in.jump;
+        } else {
+          --context.depth;
+          ++context.ip;
+        }
+        continue;
+      }
+      if (in.op == OpCode::kSleep) {
+        if (!rows.uniform(in.b, value)) {
+          stopped = true;
+          break;
+        }
+        ++context.ip;
+        ++total.leaves;
+        total.sleep = value;
+        stopped = true;
+        break;
+      }
+      rows.execute(in);
+      ++context.ip;
+      ++total.leaves;
+    }
+    if (context.ip == code.size() && context.pending == 0) {
+      context.pc++;
+      context.ip = 0;
+    }
+  }
+  rows.store();
+  return total;
+}
+
+bool lockstep_compatible(const PCB& lead, const PCB& other) {
+  return lead.program == other.program && lead.context == other.context &&
+         lead.sleepCyclesRemaining == other.sleepCyclesRemaining &&
+         !lead.isComplete() && !other.isComplete();
+}
+
+void step_lockstep(std::span<PCB* const> group, uint64_t tick, size_t budget) {
+  PCB& lead = *group.front();
+  if (group.size() == 1 || group.size() > kLockstepLanes || lead.isSleeping()) {
+    for (PCB* pcb : group) {
+      pcb->step(tick, budget);
+    }
+    return;
+  }
+
+  std::array<LockstepLane, kLockstepLanes> lanes;
+  for (size_t i = 0; i < group.size(); ++i) {
+    lanes[i].evaluator = &group[i]->evaluator;
+  }
+  ExecutionContext context = lead.context;
+  StepResult result = run_lockstep(*lead.program, context, {lanes.data(), group.size()},
+                                   budget, tick, lead.assignedCore.load(std::memory_order_relaxed));
+  for (PCB* pcb : group) {
+    pcb->context = context;
+    pcb->recordProgress(result);
+    if (result.leaves < budget && result.sleep == 0 && !pcb->isComplete()) {
+      pcb->executeCurrentInstruction(budget - result.leaves);
+    }
+    if (pcb->isSleeping()) {
+      pcb->state.store(ProcessState::Sleeping, std::memory_order_release);
+    }
+  }
+}
+
+}
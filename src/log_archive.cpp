@@ -0,0 +1,89 @@
+#include "log_archive.hpp"
+
+#include "process_control_block.hpp"
+
+namespace osemu {
+
+LogArchive::~LogArchive() { close(); }
+
+bool LogArchive::open(const std::string& path) {
+  close();
+  if (path.empty()) {
+    return true;
+  }
+  out_.open(path, std::ios::out | std::ios::trunc);
+  if (!out_.is_open()) {
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    enabled_ = true;
+    stopping_ = false;
+  }
+  writer_ = std::thread(&LogArchive::run, this);
+  return true;
+}
+
+void LogArchive::close() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    enabled_ = false;
+    stopping_ = true;
+  }
+  cv_.notify_one();
+  space_cv_.notify_all();
+  if (writer_.joinable()) {
+    writer_.join();
+  }
+  if (out_.is_open()) {
+    out_.close();
+  }
+}
+
+void LogArchive::spill(PcbRef pcb) {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    space_cv_.wait(lock, [this] {
+      return !enabled_ || pending_.size() < kMaxPending;
+    });
+    if (!enabled_) {
+      return;
+    }
+    pending_.push_back(std::move(pcb));
+  }
+  cv_.notify_one();
+}
+
+void LogArchive::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    cv_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+    if (pending_.empty()) {
+      break;
+    }
+    PcbRef pcb = std::move(pending_.front());
+    pending_.pop_front();
+    bool drained = pending_.empty();
+    lock.unlock();
+    space_cv_.notify_one();
+    write(*pcb);
+    // Flush once per burst rather than per process.
+    if (drained) {
+      out_.flush();
+    }
+    pcb = PcbRef();
+    lock.lock();
+  }
+}
+
+// The logs are freed once written, whoever else still pins the PCB.
+void LogArchive::write(PCB& pcb) {
+  out_ << "PID:" << pcb.processID << " " << pcb.processName << "\n";
+  pcb.getExecutionLogs().for_each([&](const LogRecord& line) {
+    out_ << to_string(line, pcb.processName) << "\n";
+  });
+  out_ << "\n";
+  pcb.evaluator.discard_output_log();
+}
+
+}
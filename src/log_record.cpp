@@ -0,0 +1,185 @@
+#include "log_record.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <mutex>
+
+namespace osemu {
+
+MessageTable& MessageTable::instance() {
+  static MessageTable table;
+  return table;
+}
+
+MessageTable::MessageTable() {
+  texts_.emplace_back();
+  ids_.emplace(texts_.back(), 0);
+}
+
+uint32_t MessageTable::intern(std::string_view text) {
+  {
+    std::shared_lock lock(mutex_);
+    auto it = ids_.find(text);
+    if (it != ids_.end()) {
+      return it->second;
+    }
+  }
+
+  std::unique_lock lock(mutex_);
+  auto it = ids_.find(text);
+  if (it != ids_.end()) {
+    return it->second;
+  }
+  // Keys view the deque's strings, which never move.
+  uint32_t id = static_cast<uint32_t>(texts_.size());
+  texts_.emplace_back(text);
+  ids_.emplace(texts_.back(), id);
+  return id;
+}
+
+const std::string& MessageTable::text(uint32_t id) const {
+  std::shared_lock lock(mutex_);
+  return texts_[id];
+}
+
+namespace {
+
+void put_digits(char* at, unsigned value, size_t digits) {
+  for (size_t i = digits; i-- > 0; value /= 10) {
+    at[i] = static_cast<char>('0' + value % 10);
+  }
+}
+
+// Same text as std::format("{:%m/%d/%Y %I:%M:%S %p}") on sys_seconds, from
+// the calendar arithmetic alone. False for years that need more than four
+// digits.
+bool render(int64_t seconds, std::array<char, TimestampCache::kLength>& text) {
+  using namespace std::chrono;
+  sys_seconds time{std::chrono::seconds(seconds)};
+  sys_days day = floor<days>(time);
+  year_month_day date{day};
+  int year = static_cast<int>(date.year());
+  if (year < 0 || year > 9999) {
+    return false;
+  }
+  unsigned in_day = static_cast<unsigned>((time - day).count());
+  unsigned hour = in_day / 3600;
+
+  std::memcpy(text.data(), "MM/DD/YYYY HH:MM:SS AM", TimestampCache::kLength);
+  put_digits(&text[0], static_cast<unsigned>(date.month()), 2);
+  put_digits(&text[3], static_cast<unsigned>(date.day()), 2);
+  put_digits(&text[6], static_cast<unsigned>(year), 4);
+  put_digits(&text[11], hour % 12 == 0 ? 12 : hour % 12, 2);
+  put_digits(&text[14], in_day / 60 % 60, 2);
+  put_digits(&text[17], in_day % 60, 2);
+  text[20] = hour < 12 ? 'A' : 'P';
+  return true;
+}
+
+}
+
+TimestampCache& TimestampCache::instance() {
+  static TimestampCache cache;
+  return cache;
+}
+
+int64_t TimestampCache::now() {
+  int64_t seconds = now_.load(std::memory_order_relaxed);
+  if (seconds == 0) {
+    refresh();
+    seconds = now_.load(std::memory_order_relaxed);
+  }
+  return seconds;
+}
+
+void TimestampCache::refresh() {
+  using namespace std::chrono;
+  int64_t seconds = duration_cast<std::chrono::seconds>(
+      system_clock::now().time_since_epoch()).count();
+  Text text;
+  if (now_.exchange(seconds, std::memory_order_relaxed) != seconds &&
+      render(seconds, text)) {
+    store(seconds, text);
+  }
+}
+
+void TimestampCache::append(int64_t seconds, std::string& out) {
+  Text text;
+  if (!load(seconds, text)) {
+    if (!render(seconds, text)) {
+      using namespace std::chrono;
+      out += std::format("{:%m/%d/%Y %I:%M:%S %p}", sys_seconds{std::chrono::seconds(seconds)});
+      return;
+    }
+    store(seconds, text);
+  }
+  out.append(text.data(), text.size());
+}
+
+bool TimestampCache::load(int64_t seconds, Text& text) const {
+  uint64_t before = sequence_.load(std::memory_order_acquire);
+  if (before & 1) {
+    return false;
+  }
+  int64_t held = held_.load(std::memory_order_relaxed);
+  std::array<uint64_t, (kLength + 7) / 8> words;
+  for (size_t i = 0; i < words.size(); ++i) {
+    words[i] = words_[i].load(std::memory_order_relaxed);
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (sequence_.load(std::memory_order_relaxed) != before || held != seconds) {
+    return false;
+  }
+  std::memcpy(text.data(), words.data(), kLength);
+  return true;
+}
+
+// One writer at a time; a second one leaves the held text as it is.
+void TimestampCache::store(int64_t seconds, const Text& text) {
+  if (writing_.test_and_set(std::memory_order_acquire)) {
+    return;
+  }
+  std::array<uint64_t, (kLength + 7) / 8> words{};
+  std::memcpy(words.data(), text.data(), kLength);
+
+  uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+  sequence_.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  held_.store(seconds, std::memory_order_relaxed);
+  for (size_t i = 0; i < words.size(); ++i) {
+    words_[i].store(words[i], std::memory_order_relaxed);
+  }
+  sequence_.store(sequence + 2, std::memory_order_release);
+  writing_.clear(std::memory_order_release);
+}
+
+std::string to_string(const LogRecord& record, std::string_view process_name) {
+  const MessageTable& messages = MessageTable::instance();
+
+  std::string out = "(";
+  TimestampCache::instance().append(record.time, out);
+  out += ") ";
+  if (record.core >= 0) {
+    out += std::format("Core:{} ", record.core);
+  }
+  out += '"';
+  if (record.flags & LogRecord::kGreeting) {
+    out += "Hello world from ";
+    out += process_name;
+    out += '!';
+  } else {
+    if (record.flags & LogRecord::kLead) {
+      out += std::to_string(record.lead);
+    }
+    out += messages.text(record.prefix);
+    if (record.flags & LogRecord::kValue) {
+      out += std::to_string(record.value);
+    }
+    out += messages.text(record.suffix);
+  }
+  out += '"';
+  return out;
+}
+
+}
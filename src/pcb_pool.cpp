@@ -0,0 +1,109 @@
+#include "pcb_pool.hpp"
+
+namespace osemu {
+
+PcbRef::PcbRef(PcbRef&& other) noexcept
+    : pool_(other.pool_), index_(other.index_), pcb_(other.pcb_) {
+  other.pool_ = nullptr;
+  other.pcb_ = nullptr;
+}
+
+PcbRef& PcbRef::operator=(PcbRef&& other) noexcept {
+  if (this != &other) {
+    if (pcb_ != nullptr) {
+      pool_->unref(index_);
+    }
+    pool_ = other.pool_;
+    index_ = other.index_;
+    pcb_ = other.pcb_;
+    other.pool_ = nullptr;
+    other.pcb_ = nullptr;
+  }
+  return *this;
+}
+
+PcbRef::~PcbRef() {
+  if (pcb_ != nullptr) {
+    pool_->unref(index_);
+  }
+}
+
+PcbPool::~PcbPool() {
+  for (auto& slab : slabs_) {
+    for (auto& s : slab->slots) {
+      if (s.refs.load(std::memory_order_relaxed) != 0) {
+        s.pcb()->~PCB();
+      }
+    }
+  }
+}
+
+bool PcbPool::allocate_slot(uint32_t& index) {
+  std::lock_guard<std::mutex> lock(free_mutex_);
+  if (free_slots_.empty()) {
+    if (slabs_.size() == kMaxSlabs) {
+      return false;
+    }
+    uint32_t first = static_cast<uint32_t>(slabs_.size() * kSlabSize);
+    slabs_.push_back(std::make_unique<Slab>());
+    slab_directory_[slabs_.size() - 1].store(slabs_.back().get(),
+                                             std::memory_order_release);
+    // Hand out low indices first; index 0 is skipped so that the first
+    // handle is never zero.
+    for (uint32_t i = kSlabSize; i > 0; --i) {
+      if (first + i - 1 != 0) {
+        free_slots_.push_back(first + i - 1);
+      }
+    }
+  }
+  index = free_slots_.back();
+  free_slots_.pop_back();
+  return true;
+}
+
+void PcbPool::free_slot(uint32_t index) {
+  std::lock_guard<std::mutex> lock(free_mutex_);
+  free_slots_.push_back(index);
+}
+
+PcbRef PcbPool::acquire(PcbHandle handle) const {
+  if (!handle) {
+    return PcbRef();
+  }
+  Slab* slab = slab_directory_[handle.index() / kSlabSize].load(std::memory_order_acquire);
+  if (slab == nullptr) {
+    return PcbRef();
+  }
+  Slot& s = slab->slots[handle.index() % kSlabSize];
+
+  uint32_t refs = s.refs.load(std::memory_order_relaxed);
+  do {
+    if (refs == 0) {
+      return PcbRef();
+    }
+  } while (!s.refs.compare_exchange_weak(refs, refs + 1, std::memory_order_acquire,
+                                         std::memory_order_relaxed));
+
+  // The slot may have been recycled for another process before we pinned it.
+  auto* self = const_cast<PcbPool*>(this);
+  if (s.generation.load(std::memory_order_acquire) != handle.generation()) {
+    self->unref(handle.index());
+    return PcbRef();
+  }
+  return PcbRef(self, handle.index(), s.pcb());
+}
+
+void PcbPool::unref(uint32_t index) {
+  Slot& s = slot(index);
+  if (s.refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+    return;
+  }
+
+  s.pcb()->~PCB();
+  uint32_t next = s.generation.load(std::memory_order_relaxed) + 1;
+  s.generation.store(next > PcbHandle::kMaxGeneration ? 1 : next,
+                     std::memory_order_release);
+  free_slot(index);
+}
+
+}
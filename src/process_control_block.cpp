@@ -1,119 +1,187 @@
 #include "process_control_block.hpp"
 
+#include <algorithm>
+#include <charconv>
 #include <format>
 #include <sstream>
 
 namespace osemu {
 std::atomic<uint32_t> PCB::next_pid{1}; 
 
-PCB::PCB(std::string procName, size_t totalLines)
-    : processID(next_pid++),
-      processName(std::move(procName)),
-      currentInstruction(0),
-      totalInstructions(totalLines),
-      creationTime(std::chrono::system_clock::now()),
-      assignedCore(std::nullopt),
-      sleepCyclesRemaining(0)
-{
-  evaluator.handle_declare("x", Atom(static_cast<uint16_t>(0)));
+const char* to_string(ProcessState state) {
+  switch (state) {
+    case ProcessState::New:
+      return "New";
+    case ProcessState::Ready:
+      return "Ready";
+    case ProcessState::Running:
+      return "Running";
+    case ProcessState::Sleeping:
+      return "Sleeping";
+    case ProcessState::Finished:
+      return "Finished";
+  }
+  return "Unknown";
+}
+
+std::string format_bytes(size_t bytes) {
+  if (bytes < 1024) {
+    return std::format("{} B", bytes);
+  }
+  if (bytes < 1024 * 1024) {
+    return std::format("{:.1f} KiB", bytes / 1024.0);
+  }
+  return std::format("{:.1f} MiB", bytes / (1024.0 * 1024.0));
 }
 
-PCB::PCB(std::string procName, const std::vector<Expr>& instrs)
+bool PCB::parsePriority(std::string_view text, uint8_t& priority) {
+  unsigned value = 0;
+  auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+  if (ec != std::errc() || end != text.data() + text.size() ||
+      value > kLowestPriority) {
+    return false;
+  }
+  priority = static_cast<uint8_t>(value);
+  return true;
+}
+
+PCB::PCB(std::string procName, ProgramImagePtr image, uint8_t prio)
     : processID(next_pid++),
       processName(std::move(procName)),
       currentInstruction(0),
-      totalInstructions(instrs.size()),
+      totalInstructions(image->flat_size()),
       creationTime(std::chrono::system_clock::now()),
-      assignedCore(std::nullopt),
-      sleepCyclesRemaining(0),
-      instructions(instrs)  
+      priority(std::min(prio, kLowestPriority)),
+      state(ProcessState::New),
+      assignedCore(kNoCore),
+      program(std::move(image)),
+      sleepCyclesRemaining(0)
 {
-  evaluator.handle_declare("x", Atom(static_cast<uint16_t>(0)));
+  evaluator.bind_symbols(program->names());
 }
 
 
-void PCB::step() {
+void PCB::step(uint64_t tick, size_t budget) {
   if (isSleeping()) {
     decrementSleepCycles();
+    if (!isSleeping()) {
+      state.store(ProcessState::Running, std::memory_order_release);
+    }
     return;
   }
   
-  if (currentInstruction < instructions.size()) {
-    executeCurrentInstruction();
-    ++currentInstruction;
+  if (!isComplete()) {
+    evaluator.set_log_context(tick, assignedCore.load(std::memory_order_relaxed));
+    executeCurrentInstruction(budget);
+    if (isSleeping()) {
+      state.store(ProcessState::Sleeping, std::memory_order_release);
+    }
   }
 }
 
 
-bool PCB::isComplete() const { return currentInstruction >= totalInstructions; }
+bool PCB::isComplete() const {
+  return currentInstruction.load(std::memory_order_acquire) >=
+         totalInstructions.load(std::memory_order_acquire);
+}
 
 
 
-std::string PCB::status() const {
-  
-  auto truncated_creation_time = std::chrono::time_point_cast<std::chrono::seconds>(creationTime); 
-  auto creation_time_str = std::format("{:%m/%d/%Y %I:%M:%S %p}", truncated_creation_time);
+namespace {
 
+void write_status_prefix(std::ostringstream& oss, uint32_t pid,
+                         const std::string& name,
+                         std::chrono::system_clock::time_point created) {
+  std::string creation_time_str;
+  TimestampCache::instance().append(
+      std::chrono::floor<std::chrono::seconds>(created.time_since_epoch()).count(),
+      creation_time_str);
+  oss << "PID:" << pid << " " << name << " (" << creation_time_str << ")  ";
+}
+
+}
+
+std::string ProcessSummary::status() const {
   std::ostringstream oss;
-  oss << "PID:" << processID << " " << processName << " (" << creation_time_str << ")  ";
+  write_status_prefix(oss, processID, processName, creationTime);
+  oss << "Finished           " << totalInstructions << " / " << totalInstructions;
+  return oss.str();
+}
 
-  
-  if (isComplete()) {
-    
-    oss << "Finished           " << totalInstructions << " / "
-        << totalInstructions;
-
-  } else if (assignedCore.has_value()) {
-    oss << "Core: " << *assignedCore << "            " << currentInstruction
-        << " / " << totalInstructions;
-  } else {
-    oss << "Ready (in queue)   " << currentInstruction << " / "
-        << totalInstructions;
+ProcessSummary PCB::summarize() const {
+  ProcessSummary summary;
+  summary.processID = processID;
+  summary.processName = processName;
+  summary.creationTime = creationTime;
+  summary.finishTime = finishTime;
+  summary.totalInstructions = totalInstructions;
+  return summary;
+}
+
+// Every figure is maintained as the memory is allocated, so this only sums
+// counters and is safe while the process runs.
+MemoryUsage PCB::memoryUsage() const {
+  MemoryUsage usage;
+  usage.control = sizeof(PCB) + heap_bytes(processName);
+  usage.variables = evaluator.variable_bytes();
+  usage.logs = evaluator.log_bytes();
+  usage.program = program->memory_bytes();
+  return usage;
+}
+
+std::string PCB::status() const {
+  std::ostringstream oss;
+  write_status_prefix(oss, processID, processName, creationTime);
+
+  size_t progress = currentInstruction.load(std::memory_order_acquire);
+  size_t total = totalInstructions.load(std::memory_order_acquire);
+  switch (state.load(std::memory_order_acquire)) {
+    case ProcessState::Finished:
+      oss << "Finished           " << total << " / " << total;
+      break;
+    case ProcessState::Running:
+    case ProcessState::Sleeping:
+      oss << "Core: " << assignedCore.load(std::memory_order_relaxed)
+          << "            " << progress << " / " << total;
+      break;
+    case ProcessState::New:
+    case ProcessState::Ready:
+      oss << "Ready (in queue)   " << progress << " / " << total;
+      break;
   }
   return oss.str();
 }
 
-bool PCB::executeCurrentInstruction() {
-  if (currentInstruction >= instructions.size()) {
-    return false;
+// Runs up to `budget` leaf instructions, resuming inside a FOR where the
+// last tick left off.
+bool PCB::executeCurrentInstruction(size_t budget) {
+  StepResult result = run_program(*program, context, evaluator, budget);
+  recordProgress(result);
+  return result.leaves > 0;
+}
+
+void PCB::recordProgress(const StepResult& result) {
+  if (result.leaf_delta != 0) {
+    totalInstructions.fetch_add(static_cast<size_t>(result.leaf_delta),
+                                std::memory_order_release);
   }
-  
-  try {
-    const auto& instr = instructions[currentInstruction];
-    if (instr.type == Expr::CALL && instr.var_name == "SLEEP" && instr.atom_value) {
-      uint16_t cycles = evaluator.resolve_atom_value(*instr.atom_value);
-      setSleepCycles(cycles);
-      return true;
-    }
-    
-    if (instr.type == Expr::CALL && instr.var_name == "PRINT") {
-        if (instr.atom_value) { 
-            Expr print_instr = instr;
-            if (instr.atom_value->type == Atom::STRING && instr.atom_value->string_value.empty()) {
-                print_instr.atom_value = std::make_unique<Atom>("Hello world from " + processName + "!", Atom::STRING);
-            }
-            evaluator.handle_print(*print_instr.atom_value, processName);
-        } else if (instr.lhs && instr.rhs) { 
-            std::string lhs_str = evaluator.print_atom_to_string(*instr.lhs);
-            std::string rhs_str = evaluator.print_atom_to_string(*instr.rhs);
-            Atom temp_atom(lhs_str + rhs_str, Atom::STRING);
-            evaluator.handle_print(temp_atom, processName);
-        } else {
-            
-            evaluator.evaluate(instr);
-        }
-        return true;
-    }
-    
-    
-    evaluator.evaluate(instr);
-    return true;
-  } catch (const std::exception& e) {
-    return false;
+  if (result.sleep > 0) {
+    setSleepCycles(result.sleep);
+  }
+  if (result.fault != Fault::kNone && fault.load(std::memory_order_relaxed) == Fault::kNone) {
+    faultInstruction.store(currentInstruction.load(std::memory_order_relaxed) + result.leaves,
+                           std::memory_order_relaxed);
+    fault.store(result.fault, std::memory_order_release);
+  }
+  currentInstruction.fetch_add(result.leaves, std::memory_order_release);
+  if (context.pc >= program->segment_count()) {
+    // Out of code; settle any count the loops left behind.
+    totalInstructions.store(currentInstruction.load(std::memory_order_relaxed),
+                            std::memory_order_release);
   }
 }
 
-const std::vector<std::string>& PCB::getExecutionLogs() const {
+const ProcessLog& PCB::getExecutionLogs() const {
   return evaluator.get_output_log();
 }
 
@@ -0,0 +1,232 @@
+#include "process_log.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <sstream>
+
+namespace osemu {
+
+size_t heap_bytes(const std::string& s) {
+  static const size_t kInlineCapacity = std::string().capacity();
+  return s.capacity() > kInlineCapacity ? s.capacity() + 1 : 0;
+}
+
+constexpr size_t kSpillBufferBytes = 64 * 1024;
+
+bool LogSpillFile::open(const std::string& path) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (out_.is_open() || path.empty()) {
+    return true;
+  }
+  buffer_.resize(kSpillBufferBytes);
+  out_.rdbuf()->pubsetbuf(buffer_.data(),
+                          static_cast<std::streamsize>(buffer_.size()));
+  out_.open(path, std::ios::out | std::ios::app | std::ios::binary);
+  if (!out_.is_open()) {
+    return false;
+  }
+  std::error_code ec;
+  size_ = static_cast<int64_t>(std::filesystem::file_size(path, ec));
+  if (ec) {
+    size_ = 0;
+  }
+  path_ = path;
+  enabled_ = true;
+  return true;
+}
+
+std::string LogSpillFile::path() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return path_;
+}
+
+// Block layout: "@<pid> <first> <count> <previous>\n" followed by the
+// records as stored in memory. The message ids they hold are only meaningful
+// to this run; blocks left by earlier runs are never reached, since a process
+// only follows offsets it wrote itself.
+int64_t LogSpillFile::write(uint32_t pid, const Block& block) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!enabled_) {
+    return -1;
+  }
+  std::string header = '@' + std::to_string(pid) + ' ' +
+                       std::to_string(block.first) + ' ' +
+                       std::to_string(block.lines.size()) + ' ' +
+                       std::to_string(block.previous) + '\n';
+  size_t bytes = block.lines.size() * sizeof(LogRecord);
+  out_.write(header.data(), static_cast<std::streamsize>(header.size()));
+  out_.write(reinterpret_cast<const char*>(block.lines.data()),
+             static_cast<std::streamsize>(bytes));
+  if (!out_) {
+    return -1;
+  }
+  int64_t offset = size_;
+  size_ += static_cast<int64_t>(header.size() + bytes);
+  return offset;
+}
+
+void LogSpillFile::flush() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (enabled_) {
+    out_.flush();
+  }
+}
+
+bool LogSpillFile::read(std::istream& in, int64_t offset, Block& block,
+                        size_t& count, bool with_lines) {
+  in.clear();
+  in.seekg(offset);
+  std::string header;
+  if (!std::getline(in, header) || header.empty() || header[0] != '@') {
+    return false;
+  }
+  std::istringstream fields(header.substr(1));
+  uint32_t pid = 0;
+  if (!(fields >> pid >> block.first >> count >> block.previous)) {
+    return false;
+  }
+
+  block.lines.clear();
+  if (with_lines) {
+    block.lines.resize(count);
+    in.read(reinterpret_cast<char*>(block.lines.data()),
+            static_cast<std::streamsize>(count * sizeof(LogRecord)));
+    if (!in) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void ProcessLog::configure(size_t capacity, LogSpillFile* spill, uint32_t pid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  capacity_ = capacity;
+  spill_ = spill;
+  pid_ = pid;
+  lines_.clear();
+  lines_.shrink_to_fit();
+  bytes_.store(0, std::memory_order_relaxed);
+}
+
+void ProcessLog::append(const LogRecord& line) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (capacity_ > 0 && total_ - first_in_memory_ == capacity_) {
+    if (spill_ != nullptr && spill_->enabled()) {
+      spill_oldest(std::max<size_t>(1, capacity_ / 2));
+    } else {
+      first_in_memory_++;
+      spill_begin_ = first_in_memory_;
+    }
+  }
+
+  if (capacity_ > 0 && lines_.size() == capacity_) {
+    slot(total_) = line;
+  } else {
+    // The ring fills before it wraps, so until then line `seq` is simply
+    // lines_[seq]. It grows as lines arrive, never past its capacity.
+    size_t capacity = lines_.capacity();
+    if (capacity_ > 0 && lines_.size() == capacity) {
+      lines_.reserve(std::min(capacity_, std::max<size_t>(16, 2 * capacity)));
+    }
+    lines_.push_back(line);
+    if (lines_.capacity() != capacity) {
+      bytes_.fetch_add((lines_.capacity() - capacity) * sizeof(LogRecord),
+                       std::memory_order_relaxed);
+    }
+  }
+  total_++;
+}
+
+void ProcessLog::discard() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  lines_.clear();
+  lines_.shrink_to_fit();
+  first_in_memory_ = total_;
+  spill_begin_ = total_;
+  last_block_ = -1;
+  bytes_.store(0, std::memory_order_relaxed);
+}
+
+void ProcessLog::spill_oldest(size_t count) {
+  LogSpillFile::Block block;
+  block.first = first_in_memory_;
+  block.previous = last_block_;
+  block.lines.reserve(count);
+  for (size_t seq = first_in_memory_; seq < first_in_memory_ + count; ++seq) {
+    block.lines.push_back(slot(seq));
+  }
+  first_in_memory_ += count;
+
+  int64_t offset = spill_->write(pid_, block);
+  if (offset < 0) {
+    // The chain is broken; nothing before the ring can be found again.
+    spill_begin_ = first_in_memory_;
+    last_block_ = -1;
+  } else {
+    last_block_ = offset;
+  }
+}
+
+size_t ProcessLog::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return total_;
+}
+
+void ProcessLog::read(size_t first, size_t count,
+                      const std::function<void(const LogRecord&)>& fn) const {
+  std::vector<LogRecord> recent;
+  size_t end = 0;
+  size_t ring_first = 0;
+  size_t spill_begin = 0;
+  int64_t last_block = -1;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    end = first + std::min(count, total_ - std::min(first, total_));
+    ring_first = first_in_memory_;
+    spill_begin = spill_begin_;
+    last_block = last_block_;
+    for (size_t seq = std::max(first, ring_first); seq < end; ++seq) {
+      recent.push_back(slot(seq));
+    }
+  }
+
+  size_t from = std::max(first, spill_begin);
+  size_t spilled_end = std::min(end, ring_first);
+  if (from < spilled_end && spill_ != nullptr) {
+    spill_->flush();
+    std::ifstream in(spill_->path(), std::ios::binary);
+
+    // Walk back from the newest block to the ones overlapping the range.
+    std::vector<int64_t> offsets;
+    LogSpillFile::Block block;
+    size_t lines = 0;
+    for (int64_t offset = last_block;
+         offset >= 0 && LogSpillFile::read(in, offset, block, lines, false);
+         offset = block.previous) {
+      if (block.first < spilled_end) {
+        offsets.push_back(offset);
+      }
+      if (block.first <= from) {
+        break;
+      }
+    }
+
+    for (auto it = offsets.rbegin(); it != offsets.rend(); ++it) {
+      if (!LogSpillFile::read(in, *it, block, lines)) {
+        continue;
+      }
+      for (size_t i = 0; i < block.lines.size(); ++i) {
+        size_t seq = block.first + i;
+        if (seq >= from && seq < spilled_end) {
+          fn(block.lines[i]);
+        }
+      }
+    }
+  }
+
+  for (const auto& line : recent) {
+    fn(line);
+  }
+}
+
+}
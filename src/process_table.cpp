@@ -0,0 +1,84 @@
+#include "process_table.hpp"
+
+#include <mutex>
+#include <vector>
+
+namespace osemu {
+
+ProcessTable::Shard<std::string>& ProcessTable::name_shard(const std::string& name) {
+  return by_name_[std::hash<std::string>{}(name) % kShardCount];
+}
+
+const ProcessTable::Shard<std::string>& ProcessTable::name_shard(
+    const std::string& name) const {
+  return by_name_[std::hash<std::string>{}(name) % kShardCount];
+}
+
+bool ProcessTable::insert(const std::string& name, uint32_t pid, PcbHandle handle) {
+  {
+    auto& shard = name_shard(name);
+    std::unique_lock lock(shard.mutex);
+    if (!shard.entries.try_emplace(name, handle).second) {
+      return false;
+    }
+  }
+  {
+    auto& shard = pid_shard(pid);
+    std::unique_lock lock(shard.mutex);
+    shard.entries.emplace(pid, handle);
+  }
+  size_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+bool ProcessTable::erase(const std::string& name, uint32_t pid, PcbHandle handle) {
+  {
+    auto& shard = name_shard(name);
+    std::unique_lock lock(shard.mutex);
+    auto it = shard.entries.find(name);
+    if (it == shard.entries.end() || it->second != handle) {
+      return false;
+    }
+    shard.entries.erase(it);
+  }
+  {
+    auto& shard = pid_shard(pid);
+    std::unique_lock lock(shard.mutex);
+    shard.entries.erase(pid);
+  }
+  size_.fetch_sub(1, std::memory_order_relaxed);
+  return true;
+}
+
+PcbHandle ProcessTable::find_by_name(const std::string& name) const {
+  const auto& shard = name_shard(name);
+  std::shared_lock lock(shard.mutex);
+  auto it = shard.entries.find(name);
+  return it != shard.entries.end() ? it->second : PcbHandle();
+}
+
+PcbHandle ProcessTable::find_by_pid(uint32_t pid) const {
+  const auto& shard = pid_shard(pid);
+  std::shared_lock lock(shard.mutex);
+  auto it = shard.entries.find(pid);
+  return it != shard.entries.end() ? it->second : PcbHandle();
+}
+
+void ProcessTable::for_each(const std::function<void(PcbHandle)>& fn) const {
+  std::vector<PcbHandle> batch;
+  for (const auto& shard : by_pid_) {
+    batch.clear();
+    {
+      std::shared_lock lock(shard.mutex);
+      batch.reserve(shard.entries.size());
+      for (const auto& [pid, handle] : shard.entries) {
+        batch.push_back(handle);
+      }
+    }
+    for (PcbHandle handle : batch) {
+      fn(handle);
+    }
+  }
+}
+
+}
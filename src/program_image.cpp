@@ -0,0 +1,163 @@
+#include "program_image.hpp"
+
+#include <fstream>
+#include <sstream>
+
+namespace osemu {
+
+namespace {
+
+// splitmix64: a counter-based mix, so instruction i does not depend on the
+// values generated before it.
+uint64_t mix(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+constexpr uint16_t kGeneratedAddMin = 1;
+constexpr uint16_t kGeneratedAddMax = 10;
+
+// Generated programs only use x.
+const std::vector<std::string> kGeneratedNames = {"x"};
+
+}
+
+// Only the bytecode is kept; the parsed tree is the caller's to drop.
+ProgramImage::ProgramImage(const std::vector<Expr>& instructions)
+    : size_(instructions.size()),
+      bytecode_(Bytecode::compile(instructions)) {
+  verified_ = verify(bytecode_.code(), bytecode_.names().size());
+  memory_bytes_ = sizeof(ProgramImage) + bytecode_.memory_bytes();
+}
+
+// Same shape as InstructionGenerator::generateInstructions: even lines print
+// x, odd lines add a small value to it.
+ProgramImage::ProgramImage(uint64_t seed, size_t count)
+    : generated_(true),
+      seed_(seed),
+      size_(count),
+      verified_(true),
+      print_message_(MessageTable::instance().intern("Value from: ")) {
+  memory_bytes_ = sizeof(ProgramImage);
+}
+
+uint16_t ProgramImage::generated_add_value(size_t index) const {
+  constexpr uint64_t kRange = kGeneratedAddMax - kGeneratedAddMin + 1;
+  return static_cast<uint16_t>(kGeneratedAddMin + mix(seed_ ^ index) % kRange);
+}
+
+size_t ProgramImage::segment_count() const {
+  if (generated_) {
+    return (size_ + 1) / 2;
+  }
+  return bytecode_.code().empty() ? 0 : 1;
+}
+
+std::span<const Instruction> ProgramImage::segment(size_t index,
+                                                   CodeScratch& scratch) const {
+  if (!generated_) {
+    return bytecode_.code();
+  }
+  Instruction& print = scratch[0];
+  print = Instruction();
+  print.op = OpCode::kPrint;
+  print.prefix = print_message_;
+  print.b = Operand::variable(0);
+
+  size_t add_index = 2 * index + 1;
+  if (add_index == size_) {
+    return {scratch.data(), 1};
+  }
+  print.op = OpCode::kPrintAdd;
+  Instruction& add = scratch[1];
+  add = Instruction();
+  add.op = OpCode::kAdd;
+  add.dest = 0;
+  add.a = Operand::variable(0);
+  add.b = Operand::constant(generated_add_value(add_index));
+  return scratch;
+}
+
+const std::vector<std::string>& ProgramImage::names() const {
+  return generated_ ? kGeneratedNames : bytecode_.names();
+}
+
+StepResult run_program(const ProgramImage& program, ExecutionContext& context,
+                       InstructionEvaluator& evaluator, size_t budget) {
+  StepResult total;
+  CodeScratch scratch;
+  size_t segments = program.segment_count();
+  if (!program.is_verified()) {
+    context.pc = segments;
+    total.fault = Fault::kUnverifiedProgram;
+    return total;
+  }
+  while (total.leaves < budget && context.pc < segments) {
+    std::span<const Instruction> code = program.segment(context.pc, scratch);
+    StepResult result = run_bytecode(code, context, evaluator,
+                                     budget - total.leaves);
+    total.leaves += result.leaves;
+    total.leaf_delta += result.leaf_delta;
+    if (context.ip == code.size() && context.pending == 0) {
+      context.pc++;
+      context.ip = 0;
+    }
+    if (result.sleep > 0 || result.fault != Fault::kNone) {
+      total.sleep = result.sleep;
+      total.fault = result.fault;
+      break;
+    }
+  }
+  return total;
+}
+
+ProgramImagePtr ProgramCache::load(const std::filesystem::path& file,
+                                   std::string& error) {
+  std::error_code ec;
+  auto canonical = std::filesystem::weakly_canonical(file, ec);
+  std::string key = ec ? file.string() : canonical.string();
+  auto modified = std::filesystem::last_write_time(file, ec);
+  if (ec) {
+    error = "Could not open file " + file.string();
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  if (it != entries_.end() && it->second.modified == modified) {
+    if (auto image = it->second.image.lock()) {
+      return image;
+    }
+  }
+
+  std::ifstream in(file);
+  if (!in) {
+    error = "Could not open file " + file.string();
+    return nullptr;
+  }
+  std::stringstream buffer;
+  buffer << in.rdbuf();
+
+  std::vector<Expr> program;
+  ParseResult result = InstructionParser::parse_program(buffer.str(), program);
+  if (!result.success) {
+    error = "Parse error: " + result.error_msg + "\nRemaining input: " + result.remaining;
+    return nullptr;
+  }
+
+  auto image = std::make_shared<const ProgramImage>(program);
+  if (!image->is_verified()) {
+    error = "Program " + file.string() + " failed verification";
+    if (image->fault() != Fault::kNone) {
+      error += ": instruction " + std::to_string(image->fault_instruction()) + ", " +
+               to_string(image->fault());
+    }
+    return nullptr;
+  }
+  entries_[key] = Entry{modified, image};
+  return image;
+}
+
+}
@@ -1,20 +1,42 @@
 #include "scheduler.hpp"
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <fstream>
-#include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <memory>
 #include <sstream>
 #include <thread>
 #include <random>
+#include <unordered_set>
 #include "config.hpp"
 #include "process_control_block.hpp"
 #include <atomic>
+#include <charconv>
 
 namespace osemu {
 
+namespace {
+
+// "p01", "p02", ..., "p100": at least two digits, like the names the batch
+// generator has always produced.
+std::string batch_process_name(uint32_t number) {
+  char digits[10];
+  auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), number);
+  std::string name;
+  name.reserve(3 + (end - digits));
+  name.push_back('p');
+  if (end - digits < 2) {
+    name.push_back('0');
+  }
+  name.append(digits, end);
+  return name;
+}
+
+}
+
 class Scheduler::CPUWorker {
  public:
   CPUWorker(int core_id, Scheduler& scheduler)
@@ -32,10 +54,11 @@ class Scheduler::CPUWorker {
   }
   
   
-  void assign_task(std::shared_ptr<PCB> pcb, int time_quantum){
+  void assign_task(PcbHandle process, int time_quantum){
     std::lock_guard<std::mutex> lock(mutex_);
     time_quantum_ = time_quantum;
-    current_task_ = std::move(pcb);
+    current_task_ = process;
+    preempt_requested_ = false;
     idle_ = false;
 
     cv_.notify_one(); 
@@ -43,6 +66,9 @@ class Scheduler::CPUWorker {
 
   bool is_idle() const { return idle_.load(); };
 
+  void request_preemption() { preempt_requested_ = true; }
+  bool preemption_pending() const { return preempt_requested_.load(); }
+
  private:
 
    void run(){
@@ -67,14 +93,19 @@ class Scheduler::CPUWorker {
       lock.unlock();
       execute_process(current_task_, time_quantum_);
 
-      current_task_ = nullptr;
+      current_task_ = PcbHandle();
       idle_ = true;
     }
   }
 
-  void execute_process(std::shared_ptr<PCB> pcb, int tq) {
-    pcb->assignedCore = core_id_;
-    scheduler_.move_to_running(pcb);
+  void execute_process(PcbHandle process, int tq) {
+    PCB* pcb = &scheduler_.pcb_pool_.get(process);
+    pcb->assignedCore.store(core_id_, std::memory_order_relaxed);
+    pcb->state.store(pcb->isSleeping() ? ProcessState::Sleeping
+                                       : ProcessState::Running,
+                     std::memory_order_release);
+    scheduler_.move_to_running(core_id_, process);
+    gather_companions(*pcb);
     
     size_t last_tick = scheduler_.ticks_.load(); 
     int steps = 0;
@@ -94,22 +125,88 @@ class Scheduler::CPUWorker {
       if(!scheduler_.running_.load() || shutdown_requested_.load()) break;
       last_tick = scheduler_.get_ticks();
 
+      if (preempt_requested_.exchange(false)) {
+        int waiting = scheduler_.ready_queue_.highest_level();
+        if (waiting != decltype(scheduler_.ready_queue_)::kNone &&
+            waiting < pcb->priority.load()) {
+          break;
+        }
+      }
+
       // FIXED: Changed condition to execute on every tick, not just specific intervals
       // This ensures processes actually make progress
       if(last_tick % (scheduler_.delay_per_exec_ + 1) == 0){
         
-        pcb->step();
+        if (companions_.empty()) {
+          pcb->step(last_tick, scheduler_.ins_per_tick_);
+        } else {
+          step_group(*pcb, last_tick);
+        }
         
         steps++; 
       }
     }
 
-    if(pcb->isComplete()){
-        pcb->finishTime = std::chrono::system_clock::now();
-        scheduler_.move_to_finished(pcb);
-      } else {
-        scheduler_.move_to_ready(pcb);
+    for (PcbHandle companion : companions_) {
+      release(companion);
+    }
+    companions_.clear();
+    release(process);
+  }
+
+  // With more than one instruction per tick, ready processes at the same
+  // priority that stand where `lead` does in the same program join it here
+  // and run in lockstep with it.
+  void gather_companions(PCB& lead) {
+    if (scheduler_.ins_per_tick_ <= 1 || lead.isSleeping()) {
+      return;
+    }
+    scheduler_.ready_queue_.take_if(
+        lead.priority.load(), kLockstepLanes - 1,
+        [&](PcbHandle process) {
+          return lockstep_compatible(lead, scheduler_.pcb_pool_.get(process));
+        },
+        std::back_inserter(companions_));
+    for (PcbHandle companion : companions_) {
+      PCB& pcb = scheduler_.pcb_pool_.get(companion);
+      pcb.assignedCore.store(core_id_, std::memory_order_relaxed);
+      pcb.state.store(ProcessState::Running, std::memory_order_release);
+      scheduler_.move_to_lockstep(core_id_, companion);
+    }
+  }
+
+  // Runs one tick of the group; a companion that no longer stands with
+  // `lead` leaves it.
+  void step_group(PCB& lead, uint64_t tick) {
+    std::array<PCB*, kLockstepLanes> group;
+    size_t size = 0;
+    group[size++] = &lead;
+    for (PcbHandle companion : companions_) {
+      group[size++] = &scheduler_.pcb_pool_.get(companion);
+    }
+    step_lockstep({group.data(), size}, tick, scheduler_.ins_per_tick_);
+
+    std::erase_if(companions_, [&](PcbHandle companion) {
+      if (lockstep_compatible(lead, scheduler_.pcb_pool_.get(companion))) {
+        return false;
       }
+      release(companion);
+      return true;
+    });
+  }
+
+  // Hands a process this core has stopped running back to the scheduler.
+  void release(PcbHandle process) {
+    PCB& pcb = scheduler_.pcb_pool_.get(process);
+    pcb.assignedCore.store(PCB::kNoCore, std::memory_order_relaxed);
+    if (pcb.isComplete()) {
+      pcb.finishTime = std::chrono::system_clock::now();
+      pcb.state.store(ProcessState::Finished, std::memory_order_release);
+      scheduler_.move_to_finished(core_id_, process);
+    } else {
+      pcb.state.store(ProcessState::Ready, std::memory_order_release);
+      scheduler_.move_to_ready(core_id_, process);
+    }
   }
 
   int core_id_;
@@ -118,17 +215,20 @@ class Scheduler::CPUWorker {
 
   std::atomic<bool> idle_{true};
   std::atomic<bool> shutdown_requested_{false};
+  std::atomic<bool> preempt_requested_{false};
 
   
-  std::shared_ptr<PCB> current_task_;
+  PcbHandle current_task_;
   int time_quantum_;
+  // Processes running in lockstep with current_task_.
+  std::vector<PcbHandle> companions_;
 
   
   std::mutex mutex_;
   std::condition_variable cv_;
 };
 
-Scheduler::Scheduler() : running_(false), batch_generating_(false), process_counter_(0) {}
+Scheduler::Scheduler() : running_(false), batch_generating_(false) {}
 
 Scheduler::~Scheduler() {
   if (batch_generating_.load()) {
@@ -141,7 +241,21 @@ Scheduler::~Scheduler() {
 
 void Scheduler::dispatch(){
   while(running_.load()){
-    std::shared_ptr<PCB> process;
+    // Wait for a free core before popping, so a process that arrives in the
+    // meantime with a higher priority is the one that gets it.
+    CPUWorker* idle_worker = nullptr;
+    for (auto& worker : cpu_workers_) {
+      if (worker->is_idle()) {
+        idle_worker = worker.get();
+        break;
+      }
+    }
+    if (!idle_worker) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
+
+    PcbHandle process;
 
     if(!ready_queue_.wait_and_pop(process)){
       if(!running_.load()) break;
@@ -153,32 +267,15 @@ void Scheduler::dispatch(){
       else continue;
     }
 
-    bool dispatched = false;
-    while (!dispatched && running_.load()){
-      for (auto& worker: cpu_workers_){
-        if (worker->is_idle()){
-          
-          if (algorithm_ == SchedulingAlgorithm::FCFS) {
-            int remaining_instructions = process->totalInstructions - process->currentInstruction;
-            worker->assign_task(process, remaining_instructions);
-            dispatched = true;
-            break;
-          } else if (algorithm_ == SchedulingAlgorithm::RoundRobin) {
-            int remaining_instructions = process->totalInstructions - process->currentInstruction;
-            int steps_to_run = std::min((int)quantum_cycles_, remaining_instructions);
-            worker->assign_task(process, steps_to_run);
-            dispatched = true;
-            break;
-          }
-        }
-      }
-      
-      // FIXED: Added small delay to prevent busy waiting when no cores are available
-      if (!dispatched && running_.load()) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
-      }
+    PCB& pcb = pcb_pool_.get(process);
+    if (algorithm_ == SchedulingAlgorithm::FCFS) {
+      int remaining_instructions = pcb.totalInstructions - pcb.currentInstruction;
+      idle_worker->assign_task(process, remaining_instructions);
+    } else if (algorithm_ == SchedulingAlgorithm::RoundRobin) {
+      int remaining_instructions = pcb.totalInstructions - pcb.currentInstruction;
+      int steps_to_run = std::min((int)quantum_cycles_, remaining_instructions);
+      idle_worker->assign_task(process, steps_to_run);
     }
-    
   }
 }
 
@@ -188,6 +285,7 @@ void Scheduler::global_clock(){
     
     if(!running_.load()) break;
     
+    TimestampCache::instance().refresh();
     {
         std::lock_guard<std::mutex> lock(clock_mutex_);
         ticks_++;
@@ -199,9 +297,27 @@ void Scheduler::global_clock(){
 void Scheduler::start(const Config& config) {
   running_ = true;
   delay_per_exec_ = config.delayCyclesPerInstruction;
+  ins_per_tick_ = std::max<size_t>(1, config.instructionsPerTick);
   quantum_cycles_ = config.quantumCycles;
   algorithm_ = config.scheduler;
+  max_ready_queue_ = config.maxReadyQueue;
+  max_live_processes_ = config.maxLiveProcesses;
+  max_resident_instructions_ = config.maxResidentInstructions;
+  admission_policy_ = config.admissionPolicy;
+
+  max_finished_records_ = config.maxFinishedRecords;
+  if (!log_archive_.open(config.archiveLogFile)) {
+    std::cerr << "Failed to open log archive: " << config.archiveLogFile
+              << std::endl;
+  }
+  log_buffer_lines_ = config.logBufferLines;
+  if (!log_spill_.open(config.logSpillFile)) {
+    std::cerr << "Failed to open log spill file: " << config.logSpillFile
+              << std::endl;
+  }
 
+  core_slots_ = std::vector<std::atomic<uint32_t>>(config.cpuCount);
+  lane_slots_ = std::vector<std::atomic<uint32_t>>(config.cpuCount * (kLockstepLanes - 1));
   for (uint32_t i = 0; i < config.cpuCount; ++i) {
     cpu_workers_.push_back(std::make_unique<CPUWorker>(i, *this));
     cpu_workers_.back()->start();
@@ -234,6 +350,7 @@ void Scheduler::stop() {
   }
 
   cpu_workers_.clear();
+  log_archive_.close();
   
   if(global_clock_thread_.joinable()){
     global_clock_thread_.join();
@@ -243,81 +360,270 @@ void Scheduler::stop() {
   std::cout << "Number of cycles from this run: " << ticks_.load() << std::endl;
 }
 
-void Scheduler::submit_process(std::shared_ptr<PCB> pcb) {
-  { 
-    std::lock_guard<std::mutex> lock(map_mutex_);
-    all_processes_map_[pcb->processName] = pcb;
+bool Scheduler::admission_open() const {
+  if (max_ready_queue_ > 0 && ready_queue_.size() >= max_ready_queue_) {
+    return false;
+  }
+  if (max_live_processes_ > 0 &&
+      live_processes_.load() >= max_live_processes_) {
+    return false;
+  }
+  if (max_resident_instructions_ > 0 &&
+      resident_instructions_.load() >= max_resident_instructions_) {
+    return false;
+  }
+  return true;
+}
+
+SubmitResult Scheduler::submit_process(std::string name, ProgramImagePtr program,
+                                       uint8_t priority) {
+  std::lock_guard<std::mutex> admission(admission_mutex_);
+  if (!admission_open()) {
+    rejected_arrivals_++;
+    return SubmitResult::Rejected;
+  }
+
+  priority = std::min(priority, PCB::kLowestPriority);
+  PcbHandle process = pcb_pool_.create(std::move(name), std::move(program), priority);
+  if (!process) {
+    rejected_arrivals_++;
+    return SubmitResult::Rejected;
+  }
+  PCB& pcb = pcb_pool_.get(process);
+  if (!process_table_.insert(pcb.processName, pcb.processID, process)) {
+    pcb_pool_.release(process);
+    return SubmitResult::NameTaken;
+  }
+
+  enqueue_admitted(process);
+  return SubmitResult::Admitted;
+}
+
+bool Scheduler::submit_batch_process(ProgramImagePtr program) {
+  std::lock_guard<std::mutex> admission(admission_mutex_);
+  if (!admission_open()) {
+    return false;
   }
 
-  ready_queue_.push(std::move(pcb));
+  PcbHandle process = pcb_pool_.create(std::string(), std::move(program));
+  if (!process) {
+    return false;
+  }
+  PCB& pcb = pcb_pool_.get(process);
+  // The table insert is what reserves the name; numbers whose name a user
+  // process already took are skipped.
+  do {
+    pcb.processName = batch_process_name(batch_name_counter_.fetch_add(1) + 1);
+  } while (!process_table_.insert(pcb.processName, pcb.processID, process));
+
+  enqueue_admitted(process);
+  return true;
 }
 
-void Scheduler::print_status() const {
-  size_t total_cores;
-  size_t cores_used;
-  double cpu_utilization;
-  calculate_cpu_utilization(total_cores, cores_used, cpu_utilization);
-
-  std::cout << "CPU utilization: " << static_cast<int>(cpu_utilization) << "%\n";
-  std::cout << "Cores used: " << cores_used << "\n";
-  std::cout << "Cores available: " << (total_cores - cores_used) << "\n\n";
-
-  std::cout
-      << "----------------------------------------------------------------\n";
-  std::cout << "Running processes:\n";
+void Scheduler::enqueue_admitted(PcbHandle process) {
+  PCB& pcb = pcb_pool_.get(process);
+  pcb.evaluator.configure_output_log(log_buffer_lines_, &log_spill_, pcb.processID);
+  live_processes_++;
   {
-    std::lock_guard<std::mutex> lock(running_mutex_);
-    for (const auto& pcb : running_processes_) {
-      std::cout << pcb->status() << std::endl;
+    // A generated program is charged its length too: that is what the
+    // processes running it will execute and log.
+    std::lock_guard<std::mutex> lock(resident_mutex_);
+    if (resident_programs_[pcb.program.get()]++ == 0) {
+      resident_instructions_ += pcb.program->size();
     }
   }
+  admitted_arrivals_++;
+  pcb.state.store(ProcessState::Ready, std::memory_order_release);
+  ready_queue_.push(process, pcb.priority);
+  preempt_for(pcb.priority.load());
+}
 
-  std::cout << "\nFinished processes:\n";
-  {
-    std::lock_guard<std::mutex> lock(finished_mutex_);
-    for (const auto& pcb : finished_processes_) {
-      std::cout << pcb->status() << std::endl;
+bool Scheduler::renice(const std::string& name, uint8_t priority) {
+  PcbHandle process = process_table_.find_by_name(name);
+  PcbRef pcb = pcb_pool_.acquire(process);
+  if (!pcb) {
+    return false;
+  }
+
+  priority = std::min(priority, PCB::kLowestPriority);
+  ready_queue_.relevel(process, pcb->priority, priority);
+  // Either a queued process now outranks a running one, or a running
+  // process now ranks below what is waiting.
+  int waiting = ready_queue_.highest_level();
+  if (waiting != decltype(ready_queue_)::kNone) {
+    preempt_for(static_cast<uint8_t>(waiting));
+  }
+  return true;
+}
+
+// Asks the core running the lowest-priority process below `priority` to give
+// it up at its next tick. Nothing happens while any core is idle.
+void Scheduler::preempt_for(uint8_t priority) {
+  for (const auto& worker : cpu_workers_) {
+    if (worker->is_idle()) {
+      return;
     }
   }
-  std::cout
-      << "----------------------------------------------------------------\n";
+
+  int victim_core = -1;
+  uint8_t victim_priority = priority;
+  for (size_t core = 0; core < core_slots_.size(); ++core) {
+    PcbRef pcb = pcb_pool_.acquire(
+        PcbHandle::from_raw(core_slots_[core].load(std::memory_order_acquire)));
+    if (!pcb || cpu_workers_[core]->preemption_pending()) {
+      continue;
+    }
+    if (pcb->priority.load() > victim_priority) {
+      victim_core = static_cast<int>(core);
+      victim_priority = pcb->priority.load();
+    }
+  }
+
+  if (victim_core >= 0) {
+    cpu_workers_[victim_core]->request_preemption();
+  }
 }
 
-std::shared_ptr<PCB> Scheduler::find_process_by_name(const std::string& processName) const{
-  std::lock_guard<std::mutex> lock(map_mutex_);
-  
-  auto it = all_processes_map_.find(processName);
-  
-  if (it != all_processes_map_.end()) {
-    return it->second;
+void Scheduler::write_admission_stats(std::ostream& out) const {
+  out << "Live processes: " << live_processes_.load()
+      << " (ready queue: " << ready_queue_.size()
+      << ", resident instructions: " << resident_instructions_.load() << ")\n";
+  out << "Arrivals admitted: " << admitted_arrivals_.load()
+      << ", deferred: " << deferred_arrivals_.load()
+      << ", rejected: " << rejected_arrivals_.load() << "\n";
+}
+
+Scheduler::StatusSnapshot Scheduler::snapshot() const {
+  StatusSnapshot snap;
+  snap.running = running_snapshot();
+  snap.finished = finished_processes_.snapshot();
+  snap.evicted = finished_processes_.trimmed();
+  calculate_cpu_utilization(snap.total_cores, snap.cores_used,
+                            snap.cpu_utilization);
+
+  std::unordered_set<const ProgramImage*> programs;
+  process_table_.for_each([&](PcbHandle process) {
+    PcbRef pcb = pcb_pool_.acquire(process);
+    if (!pcb) {
+      return;
+    }
+    MemoryUsage usage = pcb->memoryUsage();
+    snap.live_processes++;
+    snap.process_bytes += usage.owned();
+    if (programs.insert(pcb->program.get()).second) {
+      snap.program_bytes += usage.program;
+    }
+  });
+  return snap;
+}
+
+void Scheduler::write_memory_stats(std::ostream& out,
+                                   const StatusSnapshot& snap) const {
+  out << "Memory: " << format_bytes(snap.process_bytes + snap.program_bytes)
+      << " (" << snap.live_processes << " processes: "
+      << format_bytes(snap.process_bytes) << ", programs: "
+      << format_bytes(snap.program_bytes) << ")\n";
+}
+
+void Scheduler::write_evicted_note(std::ostream& out,
+                                   const StatusSnapshot& snap) const {
+  if (snap.evicted > 0) {
+    out << "(" << snap.evicted << " older finished processes evicted)\n";
+  }
+}
+
+void Scheduler::print_status() const {
+  const StatusSnapshot snap = snapshot();
+
+  std::ostringstream out;
+  out << "CPU utilization: " << static_cast<int>(snap.cpu_utilization) << "%\n";
+  out << "Cores used: " << snap.cores_used << "\n";
+  out << "Cores available: " << (snap.total_cores - snap.cores_used) << "\n";
+  write_admission_stats(out);
+  write_memory_stats(out, snap);
+  out << "\n";
+
+  out << "----------------------------------------------------------------\n";
+  out << "Running processes:\n";
+  for (const auto& pcb : snap.running) {
+    out << pcb->status() << "\n";
   }
 
-  return nullptr;
+  out << "\nFinished processes:\n";
+  write_evicted_note(out, snap);
+  snap.finished.for_each([&](const ProcessSummary& summary) {
+    out << summary.status() << "\n";
+  });
+  out << "----------------------------------------------------------------\n";
+
+  std::cout << out.str() << std::flush;
 }
 
-void Scheduler::move_to_running(std::shared_ptr<PCB> pcb) {
-  std::lock_guard<std::mutex> lock(running_mutex_);
-  running_processes_.push_back(std::move(pcb));
+PcbRef Scheduler::find_process_by_name(const std::string& processName) const{
+  return pcb_pool_.acquire(process_table_.find_by_name(processName));
 }
 
-void Scheduler::move_to_finished(std::shared_ptr<PCB> pcb) {
-  {
-    std::lock_guard<std::mutex> lock(running_mutex_);
-    std::lock_guard<std::mutex> lock2(finished_mutex_);
-    std::erase_if(running_processes_,
-                  [&](const auto& p) { return p.get() == pcb.get(); });
-    finished_processes_.push_back(std::move(pcb));
+PcbRef Scheduler::find_process_by_pid(uint32_t pid) const {
+  return pcb_pool_.acquire(process_table_.find_by_pid(pid));
+}
+
+void Scheduler::move_to_running(int core_id, PcbHandle process) {
+  core_slots_[core_id].store(process.raw(), std::memory_order_release);
+}
+
+void Scheduler::move_to_lockstep(int core_id, PcbHandle process) {
+  size_t first = core_id * (kLockstepLanes - 1);
+  for (size_t i = first; i < first + kLockstepLanes - 1; ++i) {
+    if (lane_slots_[i].load(std::memory_order_relaxed) == 0) {
+      lane_slots_[i].store(process.raw(), std::memory_order_release);
+      return;
+    }
+  }
+}
+
+void Scheduler::vacate(int core_id, PcbHandle process) {
+  if (core_slots_[core_id].load(std::memory_order_relaxed) == process.raw()) {
+    core_slots_[core_id].store(0, std::memory_order_release);
+    return;
+  }
+  size_t first = core_id * (kLockstepLanes - 1);
+  for (size_t i = first; i < first + kLockstepLanes - 1; ++i) {
+    if (lane_slots_[i].load(std::memory_order_relaxed) == process.raw()) {
+      lane_slots_[i].store(0, std::memory_order_release);
+      return;
+    }
   }
 }
 
-void Scheduler::move_to_ready(std::shared_ptr<PCB> pcb) {
+void Scheduler::move_to_finished(int core_id, PcbHandle process) {
+  PCB& pcb = pcb_pool_.get(process);
+  live_processes_--;
   {
-    std::lock_guard<std::mutex> lock(running_mutex_);
-    std::erase_if(running_processes_,
-                  [&](const auto& p) { return p.get() == pcb.get(); });
+    std::lock_guard<std::mutex> lock(resident_mutex_);
+    auto it = resident_programs_.find(pcb.program.get());
+    if (--it->second == 0) {
+      resident_instructions_ -= pcb.program->size();
+      resident_programs_.erase(it);
+    }
+  }
+  vacate(core_id, process);
+
+  // Keep only a compact record; the PCB (program reference, variables and
+  // logs) is freed once the last observer unpins it.
+  ProcessSummary summary = pcb.summarize();
+  log_archive_.spill(pcb_pool_.acquire(process));
+  process_table_.erase(pcb.processName, pcb.processID, process);
+  finished_processes_.append(std::move(summary));
+  if (max_finished_records_ > 0) {
+    finished_processes_.trim(max_finished_records_);
   }
+  pcb_pool_.release(process);
+}
+
+void Scheduler::move_to_ready(int core_id, PcbHandle process) {
+  vacate(core_id, process);
 
-  ready_queue_.push(std::move(pcb));
+  ready_queue_.push(process, pcb_pool_.get(process).priority);
 }
 
 void Scheduler::start_batch_generation(const Config& config) {
@@ -329,32 +635,31 @@ void Scheduler::start_batch_generation(const Config& config) {
   batch_generating_ = true;
   batch_generator_thread_ = std::make_unique<std::thread>([this, config]() {
     uint32_t cpu_cycles = 0;
+    // An arrival held back by the Defer policy, retried every cycle until
+    // the limits clear; no new arrival is generated meanwhile.
+    ProgramImagePtr arrival;
+    bool deferred = false;
     
     while (batch_generating_.load()) {
       cpu_cycles++;
       
-      if (cpu_cycles % config.processGenFrequency == 0) {
-       std::string process_name;
-       
-       {
-         std::lock_guard<std::mutex> lock(process_counter_mutex_);
-
-         do {
-           ++process_counter_;
-           std::stringstream ss;
-           ss << "p" << std::setw(2) << std::setfill('0') << process_counter_;
-           process_name = ss.str();
-         } while (find_process_by_name(process_name) != nullptr);
-       } 
-
-        auto instructions = instruction_generator_.generateRandomProgram(
+      if (!arrival && cpu_cycles % config.processGenFrequency == 0) {
+        arrival = instruction_generator_.generateLazyProgram(
           config.minInstructions, 
-          config.maxInstructions, 
-          process_name
+          config.maxInstructions
         );
-        
-        auto pcb = std::make_shared<PCB>(process_name, instructions);
-        submit_process(pcb);
+        deferred = false;
+      }
+      if (arrival) {
+        if (submit_batch_process(arrival)) {
+          arrival.reset();
+        } else if (admission_policy_ == AdmissionPolicy::Reject) {
+          rejected_arrivals_++;
+          arrival.reset();
+        } else if (!deferred) {
+          deferred_arrivals_++;
+          deferred = true;
+        }
       }
       
       std::this_thread::sleep_for(std::chrono::milliseconds(100));
@@ -377,15 +682,36 @@ void Scheduler::stop_batch_generation() {
   std::cout << "Stopped batch process generation." << std::endl;
 }
 
+// Running processes in core order, each core's lockstep companions after
+// the process in its slot.
+std::vector<PcbRef> Scheduler::running_snapshot() const {
+  std::vector<PcbRef> running;
+  running.reserve(core_slots_.size());
+  auto add = [&](const std::atomic<uint32_t>& slot) {
+    if (PcbRef pcb = pcb_pool_.acquire(
+            PcbHandle::from_raw(slot.load(std::memory_order_acquire)))) {
+      running.push_back(std::move(pcb));
+    }
+  };
+  for (size_t core = 0; core < core_slots_.size(); ++core) {
+    add(core_slots_[core]);
+    for (size_t i = 0; i < kLockstepLanes - 1; ++i) {
+      add(lane_slots_[core * (kLockstepLanes - 1) + i]);
+    }
+  }
+  return running;
+}
+
 void Scheduler::calculate_cpu_utilization(size_t& total_cores,
                                           size_t& cores_used,
                                           double& cpu_utilization) const {
-  total_cores = cpu_workers_.size();
+  total_cores = core_slots_.size();
   cores_used = 0;
 
-  {
-    std::lock_guard<std::mutex> lock(running_mutex_);
-    cores_used = running_processes_.size();
+  for (const auto& slot : core_slots_) {
+    if (slot.load(std::memory_order_acquire) != 0) {
+      cores_used++;
+    }
   }
 
   cpu_utilization =
@@ -401,30 +727,25 @@ void Scheduler::generate_report(const std::string& filename) const {
     return;
   }
 
-  size_t total_cores;
-  size_t cores_used;
-  double cpu_utilization;
-  calculate_cpu_utilization(total_cores, cores_used, cpu_utilization);
+  const StatusSnapshot snap = snapshot();
 
-  report_file << "CPU utilization: " << static_cast<int>(cpu_utilization) << "%\n";
-  report_file << "Cores used: " << cores_used << "\n";
-  report_file << "Cores available: " << (total_cores - cores_used) << "\n\n";
+  report_file << "CPU utilization: " << static_cast<int>(snap.cpu_utilization) << "%\n";
+  report_file << "Cores used: " << snap.cores_used << "\n";
+  report_file << "Cores available: " << (snap.total_cores - snap.cores_used) << "\n";
+  write_admission_stats(report_file);
+  write_memory_stats(report_file, snap);
+  report_file << "\n";
   
   report_file << "Running processes:\n";
-  {
-    std::lock_guard<std::mutex> lock(running_mutex_);
-    for (const auto& pcb : running_processes_) {
-      report_file << pcb->status() << "\n";
-    }
+  for (const auto& pcb : snap.running) {
+    report_file << pcb->status() << "\n";
   }
   
   report_file << "\nFinished processes:\n";
-  {
-    std::lock_guard<std::mutex> lock(finished_mutex_);
-    for (const auto& pcb : finished_processes_) {
-      report_file << pcb->status() << "\n";
-    }
-  }
+  write_evicted_note(report_file, snap);
+  snap.finished.for_each([&](const ProcessSummary& summary) {
+    report_file << summary.status() << "\n";
+  });
   
   report_file.close();
   std::cout << "Report generated at " << filename << "!" << std::endl;
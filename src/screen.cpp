@@ -1,7 +1,9 @@
 
 #include "screen.hpp"
 
+#include <algorithm>
 #include <atomic>  
+#include <charconv>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -14,30 +16,80 @@
 #include "console.hpp"  
 #include "instruction_generator.hpp"
 #include "process_control_block.hpp"
+#include "program_image.hpp"
 #include "instruction_parser.hpp"
 #include "scheduler.hpp"
 
 namespace osemu {
 namespace {
 
+// Processes loaded from the same .opesy file share one program image.
+ProgramCache& program_cache() {
+  static ProgramCache cache;
+  return cache;
+}
+
 
 
 
 
-std::shared_ptr<PCB> find_process(const std::string& process_name,
-                                  Scheduler& scheduler) {
-  if (scheduler.find_process_by_name(process_name) != nullptr) {
-    return scheduler.find_process_by_name(process_name);
+// Looks the process up by name first, then by PID when the argument is
+// purely numeric.
+PcbRef find_process(const std::string& process_name, Scheduler& scheduler) {
+  if (auto pcb = scheduler.find_process_by_name(process_name)) {
+    return pcb;
   }
 
-  return nullptr;
+  uint32_t pid = 0;
+  auto [end, ec] = std::from_chars(process_name.data(),
+                                   process_name.data() + process_name.size(), pid);
+  if (ec == std::errc() && end == process_name.data() + process_name.size()) {
+    return scheduler.find_process_by_pid(pid);
+  }
+  return PcbRef();
 }
 
 
+constexpr size_t kLogPageLines = 50;
+
+// Prints one page of the process's logs, whether the lines are still in
+// memory or were spilled to disk. Page 0 is the most recent one.
+void print_log_page(const PCB& pcb, size_t page) {
+  const ProcessLog& logs = pcb.getExecutionLogs();
+  size_t total = logs.size();
+  if (total == 0) {
+    std::cout << "(No logs yet)" << std::endl;
+    return;
+  }
+
+  size_t pages = (total + kLogPageLines - 1) / kLogPageLines;
+  if (page == 0 || page > pages) {
+    page = pages;
+  }
+  size_t first = (page - 1) * kLogPageLines;
+  size_t last = std::min(first + kLogPageLines, total);
+  if (pages > 1) {
+    std::cout << "(Lines " << first + 1 << "-" << last << " of " << total
+              << ", page " << page << "/" << pages
+              << "; 'logs <page>' for another page)" << std::endl;
+  }
+
+  size_t printed = 0;
+  logs.read(first, last - first, [&](const LogRecord& line) {
+    std::cout << to_string(line, pcb.processName) << std::endl;
+    printed++;
+  });
+  if (printed < last - first) {
+    std::cout << "(" << (last - first - printed)
+              << " lines on this page were dropped; set log-spill-file to keep them)"
+              << std::endl;
+  }
+}
+
 void view_process_screen(const std::string& process_name, Scheduler& scheduler) {
   // scheduler gets the process
   try {
-    std::shared_ptr<PCB> pcb = find_process(process_name, scheduler);
+    PcbRef pcb = find_process(process_name, scheduler);
 
     if (!pcb) {
       throw std::runtime_error("Process " + process_name + " not found.");
@@ -46,23 +98,34 @@ void view_process_screen(const std::string& process_name, Scheduler& scheduler)
 
 
     std::string input_line;
+    size_t log_page = 0;
     while (true) {
-      std::cout << "Process name: " << process_name << std::endl;
+      std::cout << "Process name: " << pcb->processName << std::endl;
       std::cout << "ID: "  << pcb->processID<< std::endl;
+      std::cout << "Priority: " << static_cast<int>(pcb->priority.load()) << std::endl;
+      MemoryUsage memory = pcb->memoryUsage();
+      std::cout << "Memory: " << format_bytes(memory.owned())
+                << " (PCB " << format_bytes(memory.control)
+                << ", variables " << format_bytes(memory.variables)
+                << ", logs " << format_bytes(memory.logs)
+                << "), program " << format_bytes(memory.program) << " shared"
+                << std::endl;
       std::cout << "Logs:" << std::endl;
 
-      const auto& logs = pcb->getExecutionLogs();
-      if (logs.empty()) {
-        std::cout << "(No logs yet)" << std::endl;
-      } else {
-        for (const auto& log : logs) {
-          std::cout << log << std::endl;
-        }
-      }
+      print_log_page(*pcb, log_page);
 
       std::cout << std::endl;
-      std::cout << "Current instruction line: "<< pcb->currentInstruction << std::endl;
-      std::cout << "Lines of code: " << pcb-> totalInstructions << std::endl;
+      if (pcb->state.load() == ProcessState::Finished) {
+        std::cout << "Finished!" << std::endl;
+      } else {
+        std::cout << "State: " << to_string(pcb->state.load()) << std::endl;
+        std::cout << "Current instruction line: "<< pcb->currentInstruction.load() << std::endl;
+        std::cout << "Lines of code: " << pcb-> totalInstructions << std::endl;
+      }
+      if (Fault fault = pcb->fault.load(std::memory_order_acquire); fault != Fault::kNone) {
+        std::cout << "Fault: " << to_string(fault) << " at instruction "
+                  << pcb->faultInstruction.load(std::memory_order_relaxed) << std::endl;
+      }
       std::cout << std::endl;
 
       std::cout << "root:\\> ";
@@ -74,11 +137,19 @@ void view_process_screen(const std::string& process_name, Scheduler& scheduler)
         break;
       } else if (input_line == "process-smi") {
 
+        std::cout << "\x1b[2J\x1b[H";
+        continue;
+      } else if (input_line == "logs" || input_line.rfind("logs ", 0) == 0) {
+        log_page = 0;
+        if (input_line.size() > 5) {
+          std::from_chars(input_line.data() + 5,
+                          input_line.data() + input_line.size(), log_page);
+        }
         std::cout << "\x1b[2J\x1b[H";
         continue;
       } else {
         std::cout << "Unknown command: " << input_line << std::endl;
-        std::cout << "Available commands: process-smi, exit" << std::endl;
+        std::cout << "Available commands: process-smi, logs [page], exit" << std::endl;
       }
     }
 
@@ -97,53 +168,68 @@ void view_process_screen(const std::string& process_name, Scheduler& scheduler)
 
 
 
-bool create_process(const std::string& process_name, Scheduler& scheduler, Config& config) {
+// Explains why a process was not created; true if it was.
+bool report_submit(SubmitResult result, const std::string& process_name) {
+  switch (result) {
+    case SubmitResult::Admitted:
+      return true;
+    case SubmitResult::Rejected:
+      std::cerr << "Error: Admission limits reached; process '" << process_name
+                << "' was rejected." << std::endl;
+      return false;
+    case SubmitResult::NameTaken:
+      std::cerr << "Error: Process '" << process_name
+                << "' already exists. Please choose a unique name." << std::endl;
+      return false;
+  }
+  return false;
+}
+
+bool create_process(const std::string& process_name, Scheduler& scheduler, Config& config,
+                    uint8_t priority) {
   //check for existing processname
-  if (scheduler.find_process_by_name(process_name) != nullptr) {
+  if (scheduler.find_process_by_name(process_name)) {
     std::cerr << "Error: Process '" << process_name << "' already exists. Please choose a unique name." << std::endl;
     return false; // Abort the creation
   }
 
   InstructionGenerator generator;
 
-  auto instructions = generator.generateRandomProgram(config.minInstructions, config.maxInstructions, process_name);
-  auto pcb = std::make_shared<PCB>(process_name, instructions);
-  
+  auto image = generator.generateLazyProgram(config.minInstructions, config.maxInstructions);
+  if (!report_submit(scheduler.submit_process(process_name, image, priority),
+                     process_name)) {
+    return false;
+  }
+
   std::cout << "Created process '" << process_name << "' with " 
-            << instructions.size() << " instructions." << std::endl;
+            << image->flat_size() << " instructions." << std::endl;
   
-  scheduler.submit_process(pcb);
   std::this_thread::sleep_for(std::chrono::milliseconds(100));
   return true;
 }
 
 
-void create_process_from_file(const std::string& filename, const std::string& process_name, Scheduler& scheduler) {
-  std::ifstream file(filename);
-  if (!file) {
-    std::cerr << "Error: Could not open file " << filename << std::endl;
+void create_process_from_file(const std::string& filename, const std::string& process_name,
+                              Scheduler& scheduler, uint8_t priority) {
+  if (scheduler.find_process_by_name(process_name)) {
+    std::cerr << "Error: Process '" << process_name << "' already exists. Please choose a unique name." << std::endl;
     return;
   }
-  
-  std::stringstream buffer;
-  buffer << file.rdbuf();
-  std::string input = buffer.str();
-  
-  std::vector<Expr> program;
-  ParseResult result = InstructionParser::parse_program(input, program);
-  
-  if (!result.success) {
-    std::cerr << "Parse error: " << result.error_msg << std::endl;
-    std::cerr << "Remaining input: " << result.remaining << std::endl;
+
+  std::string error;
+  ProgramImagePtr program = program_cache().load(filename, error);
+  if (!program) {
+    std::cerr << "Error: " << error << std::endl;
     return;
   }
   
-  auto pcb = std::make_shared<PCB>(process_name, program);
-  
+  if (!report_submit(scheduler.submit_process(process_name, program, priority),
+                     process_name)) {
+    return;
+  }
+
   std::cout << "Created process '" << process_name << "' from file '" << filename 
-            << "' with " << program.size() << " instructions." << std::endl;
-  
-  scheduler.submit_process(pcb);
+            << "' with " << program->flat_size() << " instructions." << std::endl;
 }
 
 enum class ScreenCommand { Start, Resume, List, File, Unknown };
@@ -151,10 +237,22 @@ enum class ScreenCommand { Start, Resume, List, File, Unknown };
 void display_usage() {
   std::cout
       << "Usage:\n"
-      << "  screen -s <name>     Start a new process with the given name.\n"
-      << "  screen -r <name>     View the real-time log of a running process.\n"
-      << "  screen -ls           List all active processes.\n"
-      << "  screen -f <file> <name>  Load process from .opesy file.\n";
+      << "  screen -s <name> [priority]         Start a new process with the given name.\n"
+      << "  screen -r <name|pid>                View the real-time log of a running process.\n"
+      << "  screen -ls                          List all active processes.\n"
+      << "  screen -f <file> <name> [priority]  Load process from .opesy file.\n"
+      << "  Priorities range from 0 (highest) to "
+      << static_cast<int>(PCB::kLowestPriority) << "; default "
+      << static_cast<int>(PCB::kDefaultPriority) << ".\n";
+}
+
+bool parse_priority(const std::vector<std::string>& args, size_t index,
+                    uint8_t& priority) {
+  priority = PCB::kDefaultPriority;
+  if (args.size() <= index) {
+    return true;
+  }
+  return PCB::parsePriority(args[index], priority);
 }
 
 ScreenCommand parse_command(const std::string& cmd) {
@@ -178,11 +276,12 @@ void screen(std::vector<std::string>& args, Scheduler& scheduler, Config& config
 
   switch (cmd) {
     case ScreenCommand::Start: {
-      if (args.size() != 2) {
+      uint8_t priority;
+      if (args.size() < 2 || args.size() > 3 || !parse_priority(args, 2, priority)) {
         display_usage();
         return;
       }
-      bool created_success = create_process(args[1], scheduler, config);
+      bool created_success = create_process(args[1], scheduler, config, priority);
       if (created_success) {
         view_process_screen(args[1],scheduler);
       }
@@ -200,13 +299,15 @@ void screen(std::vector<std::string>& args, Scheduler& scheduler, Config& config
       scheduler.print_status();
       break;
 
-    case ScreenCommand::File:
-      if (args.size() != 3) {
+    case ScreenCommand::File: {
+      uint8_t priority;
+      if (args.size() < 3 || args.size() > 4 || !parse_priority(args, 3, priority)) {
         display_usage();
         return;
       }
-      create_process_from_file(args[1], args[2], scheduler);
+      create_process_from_file(args[1], args[2], scheduler, priority);
       break;
+    }
 
     case ScreenCommand::Unknown:
     default: